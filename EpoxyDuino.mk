@@ -163,6 +163,9 @@ CPPFLAGS += $(foreach module,$(EPOXY_MODULES),$(CPPFLAGS_EXPANSION))
 # Linker settings (e.g. -lm).
 LDFLAGS ?=
 
+# The optional background writer thread of the Serial ports uses pthreads.
+LDFLAGS += -pthread
+
 # Collect list of C and C++ srcs to compile.
 #
 # 1) Collect the source files in the Epoxy Core directory. Support subdirectory
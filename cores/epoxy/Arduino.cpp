@@ -15,7 +15,275 @@
 #include <inttypes.h>
 #include <unistd.h> // usleep()
 #include <time.h> // clock_gettime()
+#if defined(__x86_64__) || defined(__i386__)
+  #include <cpuid.h> // __get_cpuid()
+  #include <x86intrin.h> // __rdtsc()
+#endif
 #include "Arduino.h"
+#include "EpoxyScheduler.h"
+#include "WInterrupts.h" // epoxyPinChanged()
+
+// -----------------------------------------------------------------------
+// Virtual time. When enabled, millis() and micros() return a simulated clock
+// which starts at 0, delay() and delayMicroseconds() advance the clock
+// instantly without sleeping, and each yield() advances the clock by a
+// configurable quantum.
+// -----------------------------------------------------------------------
+
+#if ! defined(EPOXY_VIRTUAL_TIME_QUANTUM)
+  // Default advance of the virtual clock on each yield(), which matches the 1
+  // millisecond sleep of yield() when using the real clock.
+  #define EPOXY_VIRTUAL_TIME_QUANTUM 1000
+#endif
+
+#if defined(EPOXY_VIRTUAL_TIME)
+static bool virtualTimeEnabled = true;
+#else
+static bool virtualTimeEnabled = false;
+#endif
+static uint64_t virtualMicros = 0;
+static unsigned long virtualTimeQuantum = EPOXY_VIRTUAL_TIME_QUANTUM;
+
+void enableVirtualTime() {
+  virtualTimeEnabled = true;
+}
+
+bool isVirtualTimeEnabled() {
+  return virtualTimeEnabled;
+}
+
+void setVirtualTimeQuantum(unsigned long micros) {
+  virtualTimeQuantum = micros;
+}
+
+/**
+ * Advance the virtual clock to 'target', stopping at each timer deadline along
+ * the way so that the timer handlers see the same clock as they would in real
+ * time.
+ */
+static void runVirtualTimeUntil(uint64_t target) {
+  unsigned long deadline;
+  while (epoxyNextTimerDeadline(&deadline)) {
+    long ahead = (long) (deadline - (unsigned long) virtualMicros);
+    if (ahead < 0) ahead = 0;
+    if (virtualMicros + ahead > target) break;
+    virtualMicros += ahead;
+    epoxyRunEvents(0);
+  }
+  virtualMicros = target;
+  epoxyRunEvents(0);
+}
+
+void advanceVirtualTime(unsigned long micros) {
+  if (virtualTimeEnabled) runVirtualTimeUntil(virtualMicros + micros);
+}
+
+// -----------------------------------------------------------------------
+// Clock sources for millis() and micros() when the virtual clock is not used.
+// -----------------------------------------------------------------------
+
+// A cheaper clock updated on each scheduler tick, available on Linux and
+// FreeBSD under different names.
+#if defined(CLOCK_MONOTONIC_COARSE)
+  #define EPOXY_COARSE_CLOCK_ID CLOCK_MONOTONIC_COARSE
+#elif defined(CLOCK_MONOTONIC_FAST)
+  #define EPOXY_COARSE_CLOCK_ID CLOCK_MONOTONIC_FAST
+#endif
+
+// The TSC needs the 128-bit multiply in tscMicros().
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SIZEOF_INT128__)
+  #define EPOXY_HAS_TSC 1
+#endif
+
+static EpoxyClockSource clockSource = EPOXY_CLOCK_MONOTONIC;
+
+/** Read CLOCK_MONOTONIC as nanoseconds. */
+static uint64_t monotonicNanos() {
+  struct timespec spec;
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  return (uint64_t) spec.tv_sec * 1000000000 + spec.tv_nsec;
+}
+
+#if defined(EPOXY_COARSE_CLOCK_ID)
+
+/** Return true if the coarse clock has at least 1 millisecond resolution. */
+static bool initCoarseClock() {
+  struct timespec res;
+  if (clock_getres(EPOXY_COARSE_CLOCK_ID, &res) != 0) return false;
+  return res.tv_sec == 0 && res.tv_nsec <= 1000000;
+}
+
+static unsigned long coarseMillis() {
+  struct timespec spec;
+  clock_gettime(EPOXY_COARSE_CLOCK_ID, &spec);
+  return spec.tv_sec * 1000UL + spec.tv_nsec / 1000000UL;
+}
+
+#endif
+
+#if defined(EPOXY_HAS_TSC)
+
+// micros() = (tscBaseNanos + ((rdtsc() - tscBase) * tscMultiplier) >> 32)
+// / 1000, re-anchored against CLOCK_MONOTONIC every kTscAnchorNanos.
+static uint64_t tscBase;
+static uint64_t tscBaseNanos;
+static uint64_t tscMultiplier;
+static uint64_t tscAnchorTicks;
+
+// The start of the calibration, which continues at each anchor.
+static uint64_t tscStart;
+static uint64_t tscStartNanos;
+static double tscNanosPerTick;
+
+static const uint64_t kTscAnchorNanos = 1000000000;
+
+// Maximum correction towards CLOCK_MONOTONIC over one anchor interval (0.1%).
+static const int64_t kTscMaxSlewNanos = 1000000;
+
+// A gap of this many anchor intervals without a call restarts the
+// calibration.
+static const uint64_t kTscMaxGapAnchors = 4;
+
+// Maximum number of ticks between the rdtsc() before and after a sample of
+// CLOCK_MONOTONIC, about 10 us at 3 GHz.
+static const uint64_t kTscMaxSampleTicks = 30000;
+
+/**
+ * Set the rate of the TSC clock from `nanosPerTick`, adjusted so that the
+ * clock catches up with an `offset` from CLOCK_MONOTONIC over the next
+ * anchor interval. The correction is clamped to kTscMaxSlewNanos, so a bad
+ * sample cannot change the rate by more than 0.1%, and the clock never goes
+ * backwards.
+ */
+static void setTscRate(double nanosPerTick, int64_t offset) {
+  if (offset > kTscMaxSlewNanos) offset = kTscMaxSlewNanos;
+  if (offset < -kTscMaxSlewNanos) offset = -kTscMaxSlewNanos;
+  double span = (double) kTscAnchorNanos + (double) offset;
+  tscNanosPerTick = nanosPerTick;
+  tscMultiplier = (uint64_t) (span / kTscAnchorNanos * nanosPerTick
+      * 4294967296.0);
+  tscAnchorTicks = (uint64_t) (kTscAnchorNanos / nanosPerTick);
+}
+
+/**
+ * Calibrate the TSC against CLOCK_MONOTONIC over 20 milliseconds. Return
+ * false if the CPU does not have an invariant TSC, whose rate is constant
+ * across frequency changes and sleep states, and synchronized across cores.
+ */
+static bool initTsc() {
+  unsigned int eax, ebx, ecx, edx;
+  if (! __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+  if ((edx & (1 << 8)) == 0) return false;
+
+  uint64_t startNanos = monotonicNanos();
+  uint64_t startTsc = __rdtsc();
+  uint64_t endNanos;
+  do {
+    endNanos = monotonicNanos();
+  } while (endNanos - startNanos < 20000000);
+  uint64_t endTsc = __rdtsc();
+  if (endTsc <= startTsc) return false;
+
+  tscStart = startTsc;
+  tscStartNanos = startNanos;
+  tscBase = endTsc;
+  tscBaseNanos = endNanos;
+  setTscRate((double) (endNanos - startNanos) / (double) (endTsc - startTsc),
+      0);
+  return true;
+}
+
+/**
+ * Move the anchor to the current time, and return the time of the new anchor
+ * in nanoseconds. The rate is calibrated again over the whole time since the
+ * start of the calibration, and the clock is steered towards CLOCK_MONOTONIC
+ * instead of jumping to it, so the drift stays within the error of one anchor
+ * interval. A sample of CLOCK_MONOTONIC is taken again if the thread was
+ * preempted while taking it.
+ *
+ * After a gap of more than kTscMaxGapAnchors intervals without a call, the
+ * steering of the previous interval has been applied over the whole gap, so
+ * the clock restarts from CLOCK_MONOTONIC with the current rate instead. It
+ * never goes back before the last possible value of the previous interval.
+ */
+static uint64_t reanchorTsc() {
+  uint64_t now;
+  uint64_t monotonic;
+  for (int i = 0; i < 3; i++) {
+    now = __rdtsc();
+    monotonic = monotonicNanos();
+    if (__rdtsc() - now <= kTscMaxSampleTicks) break;
+  }
+  uint64_t delta = now - tscBase;
+
+  if (delta > kTscMaxGapAnchors * tscAnchorTicks) {
+    uint64_t last = tscBaseNanos + (uint64_t) (
+        ((unsigned __int128) tscAnchorTicks * tscMultiplier) >> 32);
+    tscStart = now;
+    tscStartNanos = monotonic;
+    tscBase = now;
+    tscBaseNanos = (monotonic > last) ? monotonic : last;
+    setTscRate(tscNanosPerTick, 0);
+    return tscBaseNanos;
+  }
+
+  uint64_t nanos = tscBaseNanos
+      + (uint64_t) (((unsigned __int128) delta * tscMultiplier) >> 32);
+  tscBase = now;
+  tscBaseNanos = nanos;
+  setTscRate((double) (monotonic - tscStartNanos) / (double) (now - tscStart),
+      (int64_t) (monotonic - nanos));
+  return nanos;
+}
+
+static inline uint64_t tscMicros() {
+  uint64_t now = __rdtsc();
+  uint64_t delta = now - tscBase;
+  if (delta >= tscAnchorTicks) return reanchorTsc() / 1000;
+  uint64_t nanos = tscBaseNanos
+      + (uint64_t) (((unsigned __int128) delta * tscMultiplier) >> 32);
+  return nanos / 1000;
+}
+
+#endif
+
+bool setClockSource(EpoxyClockSource source) {
+  switch (source) {
+    case EPOXY_CLOCK_MONOTONIC:
+      clockSource = source;
+      return true;
+
+    case EPOXY_CLOCK_COARSE:
+#if defined(EPOXY_COARSE_CLOCK_ID)
+      if (initCoarseClock()) {
+        clockSource = source;
+        return true;
+      }
+#endif
+      break;
+
+    case EPOXY_CLOCK_TSC:
+#if defined(EPOXY_HAS_TSC)
+      if (initTsc()) {
+        clockSource = source;
+        return true;
+      }
+#endif
+      break;
+
+    case EPOXY_CLOCK_AUTO:
+      return setClockSource(EPOXY_CLOCK_TSC)
+          || setClockSource(EPOXY_CLOCK_COARSE)
+          || setClockSource(EPOXY_CLOCK_MONOTONIC);
+  }
+
+  clockSource = EPOXY_CLOCK_MONOTONIC;
+  return false;
+}
+
+EpoxyClockSource getClockSource() {
+  return clockSource;
+}
 
 // -----------------------------------------------------------------------
 // Arduino methods emulated in Unix
@@ -24,8 +292,51 @@
 static uint32_t digitalReadPinValues = 0;
 static uint32_t digitalWritePinValues = 0;
 
+// Maximum time that yield() waits for an event. This prevents the program
+// from consuming 100% CPU when idle, while still calling loop() at least
+// 1000 times per second for sketches which poll millis().
+#define EPOXY_YIELD_MAX_WAIT_MICROS 1000
+
+// Current wait of the EPOXY_YIELD_ADAPTIVE mode.
+static unsigned long adaptiveWaitMicros = 0;
+
+// Calls to yield() since the last poll of the EPOXY_YIELD_SPIN mode.
+static unsigned int spinCount = 0;
+
 void yield() {
-  usleep(1000); // prevents program from consuming 100% CPU
+  if (virtualTimeEnabled) {
+    runVirtualTimeUntil(virtualMicros + virtualTimeQuantum);
+    return;
+  }
+
+  switch (getYieldMode()) {
+    case EPOXY_YIELD_SPIN:
+      if (++spinCount >= EPOXY_YIELD_SPIN_POLL_INTERVAL) {
+        spinCount = 0;
+        epoxyRunEvents(0);
+      } else {
+        epoxyRunTimers();
+      }
+      break;
+
+    case EPOXY_YIELD_ADAPTIVE:
+      // Spin while there is work to do, otherwise double the wait.
+      if (epoxyRunEvents(adaptiveWaitMicros) > 0) {
+        adaptiveWaitMicros = 0;
+      } else if (adaptiveWaitMicros == 0) {
+        adaptiveWaitMicros = 1;
+      } else {
+        adaptiveWaitMicros *= 2;
+        if (adaptiveWaitMicros > EPOXY_YIELD_MAX_WAIT_MICROS) {
+          adaptiveWaitMicros = EPOXY_YIELD_MAX_WAIT_MICROS;
+        }
+      }
+      break;
+
+    default:
+      epoxyRunEvents(EPOXY_YIELD_MAX_WAIT_MICROS);
+      break;
+  }
 }
 
 void pinMode(uint8_t /*pin*/, uint8_t /*mode*/) {}
@@ -55,6 +366,10 @@ int digitalRead(uint8_t pin) {
 void digitalReadValue(uint8_t pin, uint8_t val) {
   if (pin >= 32) return;
 
+  if ((digitalRead(pin) != 0) != (val != 0)) {
+    epoxyPinChanged(pin, val != 0);
+  }
+
   if (val == 0) {
     digitalReadPinValues &= ~(((uint32_t)0x1) << pin);
   } else {
@@ -67,6 +382,21 @@ int analogRead(uint8_t /*pin*/) { return 0; }
 void analogWrite(uint8_t /*pin*/, int /*val*/) {}
 
 unsigned long millis() {
+  if (virtualTimeEnabled) return virtualMicros / 1000;
+
+  switch (clockSource) {
+#if defined(EPOXY_COARSE_CLOCK_ID)
+    case EPOXY_CLOCK_COARSE:
+      return coarseMillis();
+#endif
+#if defined(EPOXY_HAS_TSC)
+    case EPOXY_CLOCK_TSC:
+      return tscMicros() / 1000;
+#endif
+    default:
+      break;
+  }
+
   struct timespec spec;
   clock_gettime(CLOCK_MONOTONIC, &spec);
   unsigned long ms = spec.tv_sec * 1000U + spec.tv_nsec / 1000000UL;
@@ -74,6 +404,13 @@ unsigned long millis() {
 }
 
 unsigned long micros() {
+  if (virtualTimeEnabled) return virtualMicros;
+
+#if defined(EPOXY_HAS_TSC)
+  // The coarse clock is too coarse for micros(), so it uses CLOCK_MONOTONIC.
+  if (clockSource == EPOXY_CLOCK_TSC) return tscMicros();
+#endif
+
   struct timespec spec;
   clock_gettime(CLOCK_MONOTONIC, &spec);
   unsigned long us = spec.tv_sec * 1000000UL + spec.tv_nsec / 1000U;
@@ -84,12 +421,29 @@ void tone(uint8_t /*_pin*/, unsigned int /*frequency*/, unsigned long /*duration
 
 void noTone(uint8_t /*_pin*/) {}
 
+// Like the AVR and ESP8266 cores, delay() keeps servicing events (Serial
+// input, timers) while it waits.
 void delay(unsigned long ms) {
-  usleep(ms * 1000);
+  if (virtualTimeEnabled) {
+    runVirtualTimeUntil(virtualMicros + (uint64_t) ms * 1000);
+  } else {
+    unsigned long start = micros();
+    unsigned long duration = ms * 1000;
+    unsigned long elapsed;
+    while ((elapsed = micros() - start) < duration) {
+      epoxyRunEvents(duration - elapsed);
+    }
+  }
 }
 
+// Like a busy-wait on a microcontroller, delayMicroseconds() does not service
+// any events.
 void delayMicroseconds(unsigned int us) {
-  usleep(us);
+  if (virtualTimeEnabled) {
+    virtualMicros += us;
+  } else {
+    usleep(us);
+  }
 }
 
 unsigned long pulseIn(
@@ -144,6 +144,7 @@
   #define NOT_A_PORT -1
 #endif
 #define NOT_AN_INTERRUPT -1
+#define digitalPinToInterrupt(p) ((p) < 32 ? (p) : NOT_AN_INTERRUPT)
 #define NOT_ON_TIMER 0
 
 // Arduino defines min(), max(), abs(), and round() using c-preprocessor macros
@@ -166,10 +167,6 @@ using std::round;
 #define degrees(rad) ((rad)*RAD_TO_DEG)
 #define sq(x) ((x)*(x))
 
-// Stub implementations
-#define interrupts()
-#define noInterrupts()
-
 // Fake the CPU clock to 16MHz on Linxu or MacOS.
 #define F_CPU 16000000
 #define clockCyclesPerMicrosecond() ( F_CPU / 1000000L )
@@ -230,6 +227,10 @@ void analogWrite(uint8_t pin, int val);
  * uses a `uint32_t` for storage. If the `pin` is greater than or equal to 32,
  * this function does nothing and `digitalRead(pin)` will return 0.
  *
+ * If a handler was registered on the `pin` using `attachInterrupt()`, and the
+ * change of value matches its mode, the handler is queued and called at the
+ * next `yield()`, `delay()`, or `interrupts()`.
+ *
  * This function is available only on EpoxyDuino. It is not a standard Arduino
  * function, so it is not available when compiling on actual hardware.
  */
@@ -252,11 +253,95 @@ unsigned long micros();
 void delay(unsigned long ms);
 void delayMicroseconds(unsigned int us);
 
+/**
+ * Switch `millis()`, `micros()`, `delay()` and `delayMicroseconds()` to a
+ * simulated clock which starts at 0. In this mode, `delay()` advances the
+ * clock immediately without sleeping, and `yield()` advances the clock by the
+ * quantum given by `setVirtualTimeQuantum()`. This should be called before
+ * the first call to `millis()` or `micros()`, usually at the start of
+ * `setup()`. It is also enabled by compiling with the `EPOXY_VIRTUAL_TIME`
+ * macro, or by setting the `EPOXY_VIRTUAL_TIME=1` environment variable.
+ *
+ * This function is available only on EpoxyDuino.
+ */
+void enableVirtualTime();
+
+/** Return true if the virtual clock is used. Available only on EpoxyDuino. */
+bool isVirtualTimeEnabled();
+
+/**
+ * Set the number of microseconds that the virtual clock advances on each call
+ * to `yield()`. The default is 1000, which mimics the 1 millisecond sleep of
+ * `yield()` when using the real clock. It can also be set by the
+ * `EPOXY_VIRTUAL_TIME_QUANTUM` macro or environment variable.
+ *
+ * This function is available only on EpoxyDuino.
+ */
+void setVirtualTimeQuantum(unsigned long micros);
+
+/**
+ * Advance the virtual clock by `micros` microseconds. This is a no-op unless
+ * `enableVirtualTime()` is active. Available only on EpoxyDuino.
+ */
+void advanceVirtualTime(unsigned long micros);
+
+/** Time source of `millis()` and `micros()` when virtual time is not used. */
+enum EpoxyClockSource {
+  /** Try TSC, then COARSE, then MONOTONIC. */
+  EPOXY_CLOCK_AUTO = 0,
+
+  /** `clock_gettime(CLOCK_MONOTONIC)`. This is the default. */
+  EPOXY_CLOCK_MONOTONIC = 1,
+
+  /**
+   * `CLOCK_MONOTONIC_COARSE` for `millis()` if its resolution is 1 millisecond
+   * or better. `micros()` continues to use `CLOCK_MONOTONIC`.
+   */
+  EPOXY_CLOCK_COARSE = 2,
+
+  /** x86 invariant TSC, calibrated against `CLOCK_MONOTONIC` at selection. */
+  EPOXY_CLOCK_TSC = 3,
+};
+
+/**
+ * Select the clock source of `millis()` and `micros()`. Returns false and falls
+ * back to `EPOXY_CLOCK_MONOTONIC` if the requested source is not available on
+ * this machine. It can also be selected at startup using the `EPOXY_CLOCK`
+ * environment variable set to `auto`, `monotonic`, `coarse` or `tsc`. Selecting
+ * the clock in the middle of a program may cause the clock to jump, so this
+ * should be called at the start of `setup()`.
+ *
+ * This function is available only on EpoxyDuino.
+ */
+bool setClockSource(EpoxyClockSource source);
+
+/** Return the current clock source. Available only on EpoxyDuino. */
+EpoxyClockSource getClockSource();
+
 unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout);
 unsigned long pulseInLong(uint8_t pin, uint8_t state, unsigned long timeout);
 void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val);
 uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder);
 
+/**
+ * Enable the dispatch of the interrupt handlers, and call those which were
+ * queued while they were disabled.
+ */
+void interrupts();
+
+/**
+ * Disable the dispatch of the interrupt handlers. Interrupt requests continue
+ * to be queued, and are handled when `interrupts()` is called.
+ */
+void noInterrupts();
+
+/**
+ * Register the handler of the interrupt number `interruptNum`, which is the
+ * same as the pin number through `digitalPinToInterrupt()`. The handler is
+ * queued when `digitalReadValue()` changes the pin according to `mode`
+ * (`RISING`, `FALLING`, `CHANGE`), or on each dispatch while the pin stays at
+ * the level selected by the `LOW` mode (`ONLOW` or `ONHIGH` on ESP8266).
+ */
 void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode);
 void detachInterrupt(uint8_t interruptNum);
 #if defined(EPOXY_CORE_ESP8266)
@@ -278,6 +363,44 @@ extern int epoxy_argc;
 /** Copy of the argv parameter of main() as a global variable. */
 extern const char* const* epoxy_argv;
 
+/** How `yield()` waits for events when using the real clock. */
+enum EpoxyYieldMode {
+  /** Block in poll() for up to 1 millisecond. This is the default. */
+  EPOXY_YIELD_SLEEP = 0,
+
+  /**
+   * Never block. Uses 100% CPU, but shows the true cost of each loop(). The
+   * timers run on every call, but the file descriptors are polled only once
+   * every `EPOXY_YIELD_SPIN_POLL_INTERVAL` calls, to avoid a syscall per
+   * call.
+   */
+  EPOXY_YIELD_SPIN = 1,
+
+  /**
+   * Never block while events (Serial input and output, timers, etc) are being
+   * handled, then back off exponentially from 1 microsecond up to 1
+   * millisecond while idle. Only the events dispatched by yield() count as
+   * activity, so a loop() which computes without any I/O also sees the wait
+   * of up to 1 millisecond on each yield().
+   */
+  EPOXY_YIELD_ADAPTIVE = 2,
+};
+
+#if ! defined(EPOXY_YIELD_SPIN_POLL_INTERVAL)
+  /** Number of calls to yield() between two polls in EPOXY_YIELD_SPIN. */
+  #define EPOXY_YIELD_SPIN_POLL_INTERVAL 64
+#endif
+
+/**
+ * Select the yield mode. It can also be selected at runtime using the
+ * `EPOXY_YIELD_MODE` environment variable with the value `sleep`, `spin` or
+ * `adaptive`. Available only on EpoxyDuino.
+ */
+void setYieldMode(EpoxyYieldMode mode);
+
+/** Return the current yield mode. Available only on EpoxyDuino. */
+EpoxyYieldMode getYieldMode();
+
 /**
  * Enable echoing of each character. By default echoing is turned off for
  * consistency with the behavior of the serial port of a real Arduino
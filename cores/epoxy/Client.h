@@ -38,6 +38,8 @@ class Client: public Stream {
         virtual int available() override = 0;
         virtual int read() override = 0;
         /* virtual int read(uint8_t *buf, size_t size) override = 0; */
+        // Inherit the default bulk read of Stream, which calls read().
+        using Stream::read;
         virtual int peek() override = 0;
         virtual void flush() override = 0;
         virtual void stop() = 0;
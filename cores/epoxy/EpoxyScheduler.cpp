@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2026 Brian T. Park
+ * MIT License
+ */
+
+#include <poll.h>
+#include <time.h> // struct timespec
+#include "Arduino.h" // micros(), isVirtualTimeEnabled()
+#include "EpoxyScheduler.h"
+#include "WInterrupts.h" // epoxyDispatchInterrupts()
+
+// -----------------------------------------------------------------------
+// File descriptors
+// -----------------------------------------------------------------------
+
+struct FdEntry {
+  int fd;
+  short events;
+  bool used;
+  EpoxyFdHandler handler;
+  void* arg;
+};
+
+static FdEntry fdEntries[EPOXY_SCHEDULER_MAX_FDS];
+
+static FdEntry* findFd(int fd) {
+  for (FdEntry* e = fdEntries; e < fdEntries + EPOXY_SCHEDULER_MAX_FDS; e++) {
+    if (e->used && e->fd == fd) return e;
+  }
+  return nullptr;
+}
+
+bool epoxyAddFd(int fd, short events, EpoxyFdHandler handler, void* arg) {
+  FdEntry* entry = findFd(fd);
+  if (entry == nullptr) {
+    for (FdEntry* e = fdEntries; e < fdEntries + EPOXY_SCHEDULER_MAX_FDS; e++) {
+      if (! e->used) {
+        entry = e;
+        break;
+      }
+    }
+    if (entry == nullptr) return false;
+  }
+
+  entry->fd = fd;
+  entry->events = events;
+  entry->handler = handler;
+  entry->arg = arg;
+  entry->used = true;
+  return true;
+}
+
+void epoxySetFdEvents(int fd, short events) {
+  FdEntry* entry = findFd(fd);
+  if (entry) entry->events = events;
+}
+
+void epoxyRemoveFd(int fd) {
+  FdEntry* entry = findFd(fd);
+  if (entry) entry->used = false;
+}
+
+/**
+ * Wait up to waitMicros for the registered file descriptors, and call the
+ * handlers of the ones which are ready. Return the number of handlers called.
+ */
+static int pollFds(unsigned long waitMicros) {
+  struct pollfd fds[EPOXY_SCHEDULER_MAX_FDS];
+  nfds_t nfds = 0;
+  for (FdEntry* e = fdEntries; e < fdEntries + EPOXY_SCHEDULER_MAX_FDS; e++) {
+    if (e->used && e->events != 0) {
+      fds[nfds].fd = e->fd;
+      fds[nfds].events = e->events;
+      fds[nfds].revents = 0;
+      nfds++;
+    }
+  }
+  if (nfds == 0 && waitMicros == 0) return 0;
+
+#if defined(__linux__) || defined(__FreeBSD__)
+  // ppoll() provides microsecond resolution for the timeout.
+  struct timespec ts;
+  ts.tv_sec = waitMicros / 1000000;
+  ts.tv_nsec = (waitMicros % 1000000) * 1000;
+  int status = ppoll(fds, nfds, &ts, nullptr);
+#else
+  // MacOS does not have ppoll(), so round up to the next millisecond.
+  int status = poll(fds, nfds, (int) ((waitMicros + 999) / 1000));
+#endif
+  if (status <= 0) return 0;
+
+  int count = 0;
+  for (nfds_t i = 0; i < nfds; i++) {
+    if (fds[i].revents == 0) continue;
+
+    // An earlier handler may have removed or paused this fd.
+    FdEntry* entry = findFd(fds[i].fd);
+    if (entry == nullptr || entry->events == 0) continue;
+
+    // A closed fd would be reported on every poll(), so stop watching it.
+    if (fds[i].revents & POLLNVAL) {
+      entry->events = 0;
+      continue;
+    }
+
+    entry->handler(fds[i].fd, fds[i].revents, entry->arg);
+    count++;
+  }
+  return count;
+}
+
+// -----------------------------------------------------------------------
+// Timers
+// -----------------------------------------------------------------------
+
+struct TimerEntry {
+  bool active;
+  unsigned long deadline;
+  unsigned long period;
+  EpoxyTimerHandler handler;
+  void* arg;
+};
+
+static TimerEntry timerEntries[EPOXY_SCHEDULER_MAX_TIMERS];
+
+int epoxyStartTimer(unsigned long delayMicros, unsigned long periodMicros,
+    EpoxyTimerHandler handler, void* arg) {
+  for (int id = 0; id < EPOXY_SCHEDULER_MAX_TIMERS; id++) {
+    TimerEntry& timer = timerEntries[id];
+    if (timer.active) continue;
+
+    timer.deadline = micros() + delayMicros;
+    timer.period = periodMicros;
+    timer.handler = handler;
+    timer.arg = arg;
+    timer.active = true;
+    return id;
+  }
+  return -1;
+}
+
+void epoxyStopTimer(int id) {
+  if (id < 0 || id >= EPOXY_SCHEDULER_MAX_TIMERS) return;
+  timerEntries[id].active = false;
+}
+
+bool epoxyNextTimerDeadline(unsigned long* deadline) {
+  bool found = false;
+  unsigned long now = micros();
+  long earliest = 0;
+  for (TimerEntry* t = timerEntries;
+      t < timerEntries + EPOXY_SCHEDULER_MAX_TIMERS; t++) {
+    if (! t->active) continue;
+
+    // Compare relative to 'now' to handle the rollover of micros().
+    long remaining = (long) (t->deadline - now);
+    if (! found || remaining < earliest) {
+      earliest = remaining;
+      found = true;
+    }
+  }
+  if (found) *deadline = now + earliest;
+  return found;
+}
+
+/** Call the handlers of the expired timers. Return the number of calls. */
+static int runTimers() {
+  int count = 0;
+  for (TimerEntry* t = timerEntries;
+      t < timerEntries + EPOXY_SCHEDULER_MAX_TIMERS; t++) {
+    // The handler may stop or restart the timer, so check on each iteration.
+    while (t->active && (long) (t->deadline - micros()) <= 0) {
+      EpoxyTimerHandler handler = t->handler;
+      void* arg = t->arg;
+      if (t->period == 0) {
+        t->active = false;
+      } else {
+        t->deadline += t->period;
+      }
+      handler(arg);
+      count++;
+    }
+  }
+  return count;
+}
+
+// -----------------------------------------------------------------------
+// Event loop
+// -----------------------------------------------------------------------
+
+int epoxyRunEvents(unsigned long maxWaitMicros) {
+  unsigned long wait = isVirtualTimeEnabled() ? 0 : maxWaitMicros;
+
+  unsigned long deadline;
+  if (wait > 0 && epoxyNextTimerDeadline(&deadline)) {
+    long remaining = (long) (deadline - micros());
+    if (remaining <= 0) {
+      wait = 0;
+    } else if ((unsigned long) remaining < wait) {
+      wait = remaining;
+    }
+  }
+
+  int count = pollFds(wait);
+  return count + epoxyRunTimers();
+}
+
+int epoxyRunTimers() {
+  int count = runTimers();
+
+  // Interrupt handlers queued by the fd and timer handlers, or by loop().
+  epoxyDispatchInterrupts();
+  return count;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2026 Brian T. Park
+ * MIT License
+ */
+
+/**
+ * @file EpoxyScheduler.h
+ *
+ * A small event loop which drives `yield()` and `delay()` on EpoxyDuino.
+ * Instead of sleeping for a fixed 1 millisecond, `yield()` blocks in `poll()`
+ * until one of the registered file descriptors becomes ready, the next timer
+ * expires, or the maximum wait time elapses, whichever comes first. The
+ * handlers are then called from inside `yield()`, in the same thread as
+ * `loop()`.
+ *
+ * These functions are available only on EpoxyDuino.
+ */
+
+#ifndef EPOXY_DUINO_EPOXY_SCHEDULER_H
+#define EPOXY_DUINO_EPOXY_SCHEDULER_H
+
+#include <stdint.h>
+
+/** Maximum number of file descriptors which can be registered. */
+#define EPOXY_SCHEDULER_MAX_FDS 16
+
+/** Maximum number of timers which can be active at the same time. */
+#define EPOXY_SCHEDULER_MAX_TIMERS 16
+
+/**
+ * Called from `yield()` when the file descriptor `fd` is ready. The `revents`
+ * are the `POLLIN`, `POLLOUT`, `POLLHUP`, etc flags returned by `poll()`.
+ */
+typedef void (*EpoxyFdHandler)(int fd, short revents, void* arg);
+
+/** Called from `yield()` or `delay()` when a timer expires. */
+typedef void (*EpoxyTimerHandler)(void* arg);
+
+/**
+ * Register the file descriptor `fd` so that `yield()` wakes up when any of
+ * the `events` (`POLLIN`, `POLLOUT`) occur, and calls `handler`. Registering
+ * an `fd` a second time replaces its previous `events`, `handler` and `arg`.
+ * Returns false if the table is full.
+ */
+bool epoxyAddFd(int fd, short events, EpoxyFdHandler handler, void* arg);
+
+/**
+ * Change the `events` monitored for a registered `fd`. Setting `events` to 0
+ * pauses the monitoring without removing the registration, which is useful
+ * when the handler has nowhere to put more data.
+ */
+void epoxySetFdEvents(int fd, short events);
+
+/** Remove the registration of `fd`. */
+void epoxyRemoveFd(int fd);
+
+/**
+ * Start a timer which calls `handler` after `delayMicros`, then every
+ * `periodMicros` if `periodMicros` is not 0. The deadlines are measured in
+ * `micros()`, so they follow the virtual clock if it is enabled. A periodic
+ * timer which falls behind is called once for each missed period. Returns the
+ * timer id, or -1 if all timers are in use.
+ */
+int epoxyStartTimer(unsigned long delayMicros, unsigned long periodMicros,
+    EpoxyTimerHandler handler, void* arg);
+
+/** Stop the timer with the given `id`. It is safe to call from its handler. */
+void epoxyStopTimer(int id);
+
+/**
+ * Return true and set `deadline` to the `micros()` value of the earliest
+ * active timer, or return false if no timer is active.
+ */
+bool epoxyNextTimerDeadline(unsigned long* deadline);
+
+/**
+ * Wait up to `maxWaitMicros` for a registered file descriptor to become ready
+ * or for the next timer to expire, then call the handlers of those which are
+ * ready, and finally the queued interrupt handlers. The wait is shortened to
+ * the next timer deadline, and is skipped entirely when the virtual clock is
+ * enabled. Returns the number of fd and timer handlers which were called.
+ */
+int epoxyRunEvents(unsigned long maxWaitMicros);
+
+/**
+ * Call the handlers of the expired timers, then the queued interrupt
+ * handlers, without polling the file descriptors. This makes no syscall, and
+ * is used by the `spin` mode of `yield()`. Returns the number of timer
+ * handlers which were called.
+ */
+int epoxyRunTimers();
+
+#endif
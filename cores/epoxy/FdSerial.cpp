@@ -0,0 +1,672 @@
+/*
+ * Copyright (c) 2026 Brian T. Park
+ * MIT License
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h> // fprintf(), perror()
+#include <stdlib.h> // atexit(), posix_openpt()
+#include <string.h> // memcpy(), memchr()
+#include <sys/socket.h>
+#include <sys/stat.h> // mkfifo()
+#include <sys/un.h> // sockaddr_un
+#include <termios.h> // cfmakeraw()
+#include <unistd.h>
+#include "Arduino.h" // micros(), delayMicroseconds()
+#include "EpoxyScheduler.h"
+#include "FdSerial.h"
+#include "SerialTrace.h"
+#include "SerialWriterThread.h"
+
+FdSerial Serial1;
+FdSerial Serial2;
+FdSerial Serial3;
+
+/** Current time in nanoseconds, following the virtual clock if enabled. */
+static uint64_t nowNanos() {
+  return (uint64_t) micros() * 1000;
+}
+
+static void flushPortsAtExit() {
+  Serial1.flush();
+  Serial2.flush();
+  Serial3.flush();
+  Serial1.stopWriterThread();
+  Serial2.stopWriterThread();
+  Serial3.stopWriterThread();
+  Serial1.stopTrace();
+  Serial2.stopTrace();
+  Serial3.stopTrace();
+}
+
+static void registerAtExit() {
+  static bool atexitRegistered = false;
+  if (! atexitRegistered) {
+    atexit(flushPortsAtExit);
+    atexitRegistered = true;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Event loop integration
+//-----------------------------------------------------------------------------
+
+void FdSerial::setFds(int in, int out, bool blocking) {
+  inFd = in;
+  outFd = out;
+  blockingWrite = blocking;
+  inputEof = false;
+  inEvents = 0;
+  outEvents = 0;
+  if (inFd >= 0) epoxyAddFd(inFd, 0, handleReady, this);
+  if (outFd >= 0 && outFd != inFd) epoxyAddFd(outFd, 0, handleReady, this);
+  updateEvents();
+}
+
+void FdSerial::updateEvents() {
+  short in = (inFd >= 0 && ! replay && rxCount < EPOXY_SERIAL_RX_BUFFER_SIZE
+      && ! inputEof) ? POLLIN : 0;
+  short out = (outFd >= 0 && txStart < txEnd) ? POLLOUT : 0;
+  if (in == inEvents && out == outEvents) return;
+
+  inEvents = in;
+  outEvents = out;
+  if (inFd == outFd) {
+    if (inFd >= 0) epoxySetFdEvents(inFd, in | out);
+  } else {
+    if (inFd >= 0) epoxySetFdEvents(inFd, in);
+    if (outFd >= 0) epoxySetFdEvents(outFd, out);
+  }
+}
+
+// Called from yield() when the input is readable or the output is writable.
+void FdSerial::handleReady(int fd, short revents, void* arg) {
+  FdSerial* serial = (FdSerial*) arg;
+  if (fd == serial->inFd && (revents & (POLLIN | POLLHUP | POLLERR))) {
+    serial->fillRx();
+  }
+  // The input handler may have closed a disconnected socket.
+  if (fd == serial->outFd && (revents & (POLLOUT | POLLHUP | POLLERR))) {
+    serial->drainTx();
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Input
+//-----------------------------------------------------------------------------
+
+void FdSerial::fillRx() {
+  if (rxCount == 0) rxHead = 0;
+
+  while ((inFd >= 0 || replay)
+      && rxCount < EPOXY_SERIAL_RX_BUFFER_SIZE && ! inputEof) {
+    size_t tail = (rxHead + rxCount) % EPOXY_SERIAL_RX_BUFFER_SIZE;
+    size_t space = (tail >= rxHead)
+        ? EPOXY_SERIAL_RX_BUFFER_SIZE - tail
+        : rxHead - tail;
+    ssize_t status = replay
+        ? readReplay(rxBuffer + tail, space)
+        : ::read(inFd, rxBuffer + tail, space);
+    if (status > 0) {
+      if (trace) trace->record(EPOXY_TRACE_RX, rxBuffer + tail, status);
+      rxCount += status;
+      // A short read means that the input is drained. The replay returns one
+      // record at a time.
+      if (! replay && (size_t) status < space) break;
+    } else if (status < 0 && errno == EINTR) {
+      continue;
+    } else if (status < 0 && errno == EAGAIN) {
+      break;
+    } else {
+      // End of file (e.g. /dev/null, closed pipe) or an unreadable input (e.g.
+      // a directory) would also be reported on every poll().
+      handleInputClosed();
+    }
+  }
+  updateEvents();
+}
+
+void FdSerial::handleInputClosed() {
+  if (listenFd < 0 || replay) {
+    inputEof = true;
+    return;
+  }
+
+  // The client of the Unix socket went away, so wait for the next one. The
+  // input which was already received can still be read.
+  epoxyRemoveFd(inFd);
+  ::close(inFd);
+  inFd = -1;
+  outFd = -1;
+  txStart = 0;
+  txEnd = 0;
+  inEvents = 0;
+  outEvents = 0;
+}
+
+void FdSerial::consumeRx(size_t n) {
+  rxHead = (rxHead + n) % EPOXY_SERIAL_RX_BUFFER_SIZE;
+  rxCount -= n;
+  rxArrivedCount = (rxArrivedCount > n) ? rxArrivedCount - n : 0;
+}
+
+int FdSerial::read() {
+  if (rxCount == 0) fillRx();
+  if (rxArrived() == 0) return -1;
+
+  uint8_t c = rxBuffer[rxHead];
+  consumeRx(1);
+  updateEvents();
+  return c;
+}
+
+int FdSerial::peek() {
+  if (rxCount == 0) fillRx();
+  if (rxArrived() == 0) return -1;
+  return rxBuffer[rxHead];
+}
+
+int FdSerial::available() {
+  if (rxCount < EPOXY_SERIAL_RX_BUFFER_SIZE / 2) fillRx();
+  return rxArrived();
+}
+
+int FdSerial::read(uint8_t* buffer, size_t size) {
+  size_t count = 0;
+  while (count < size) {
+    // Fills the buffer when it is empty, and stops at its end.
+    size_t n = peekAvailable();
+    if (n == 0) break;
+    if (n > size - count) n = size - count;
+    memcpy(buffer + count, rxBuffer + rxHead, n);
+    consumeRx(n);
+    count += n;
+  }
+  updateEvents();
+  return count;
+}
+
+size_t FdSerial::peekAvailable() {
+  if (rxCount == 0) fillRx();
+  size_t arrived = rxArrived();
+  size_t contiguous = EPOXY_SERIAL_RX_BUFFER_SIZE - rxHead;
+  return (arrived < contiguous) ? arrived : contiguous;
+}
+
+void FdSerial::peekConsume(size_t consume) {
+  size_t arrived = rxArrived();
+  consumeRx((consume < arrived) ? consume : arrived);
+  updateEvents();
+}
+
+//-----------------------------------------------------------------------------
+// Output
+//-----------------------------------------------------------------------------
+
+void FdSerial::drainTx() {
+  while (txStart < txEnd && outFd >= 0) {
+    ssize_t status;
+    if (listenFd >= 0) {
+#if defined(MSG_NOSIGNAL)
+      // Do not kill the program with SIGPIPE if the client went away.
+      status = ::send(outFd, txBuffer + txStart, txEnd - txStart, MSG_NOSIGNAL);
+#else
+      status = ::send(outFd, txBuffer + txStart, txEnd - txStart, 0);
+#endif
+    } else {
+      status = ::write(outFd, txBuffer + txStart, txEnd - txStart);
+    }
+
+    if (status > 0) {
+      txStart += status;
+    } else if (status < 0 && errno == EINTR) {
+      continue;
+    } else if (status < 0 && errno == EAGAIN) {
+      // Continue when yield() finds the output writable. Note that STDOUT
+      // shares the O_NONBLOCK flag of STDIN if both are the terminal.
+      updateEvents();
+      return;
+    } else {
+      // The output cannot be sent (e.g. closed STDOUT), so discard it.
+      break;
+    }
+  }
+
+  // Everything was sent, or there is nowhere to send it.
+  txStart = 0;
+  txEnd = 0;
+  updateEvents();
+}
+
+void FdSerial::flush() {
+  if (writer) {
+    writer->drain();
+    return;
+  }
+
+  drainTx();
+  if (! blockingWrite) return;
+
+  while (txStart < txEnd) {
+    struct pollfd pfd = {outFd, POLLOUT, 0};
+    poll(&pfd, 1, -1);
+    drainTx();
+  }
+}
+
+void FdSerial::makeTxRoom() {
+  if (blockingWrite) {
+    flush();
+    return;
+  }
+
+  drainTx();
+  if (txStart > 0) {
+    memmove(txBuffer, txBuffer + txStart, txEnd - txStart);
+    txEnd -= txStart;
+    txStart = 0;
+  }
+}
+
+size_t FdSerial::write(uint8_t c) {
+  if (isBaudEmulated() && acquireUartTx(1) == 0) {
+    txDroppedCount++;
+    return 0;
+  }
+  if (writer) {
+    size_t n = writer->push(&c, 1);
+    if (trace) trace->record(EPOXY_TRACE_TX, &c, n);
+    return n;
+  }
+
+  if (txEnd == EPOXY_SERIAL_TX_BUFFER_SIZE) {
+    makeTxRoom();
+    if (txEnd == EPOXY_SERIAL_TX_BUFFER_SIZE) return 0;
+  }
+
+  // Let yield() send the output, instead of sending it immediately.
+  txBuffer[txEnd++] = c;
+  if (trace) trace->record(EPOXY_TRACE_TX, &c, 1);
+  updateEvents();
+
+  if (c == '\n' && txLineBuffered) flush();
+  return 1;
+}
+
+size_t FdSerial::write(const uint8_t* buffer, size_t size) {
+  size_t count = 0;
+  while (count < size) {
+    size_t n = size - count;
+    if (isBaudEmulated()) {
+      n = acquireUartTx(n);
+      if (n == 0) break;
+    }
+
+    if (writer) {
+      size_t pushed = writer->push(buffer + count, n);
+      if (trace) trace->record(EPOXY_TRACE_TX, buffer + count, pushed);
+      count += pushed;
+      // The writer counted the bytes which it dropped.
+      if (pushed < n) return count;
+      continue;
+    }
+    if (txEnd == EPOXY_SERIAL_TX_BUFFER_SIZE) {
+      makeTxRoom();
+      if (txEnd == EPOXY_SERIAL_TX_BUFFER_SIZE) break;
+    }
+    if (n > EPOXY_SERIAL_TX_BUFFER_SIZE - txEnd) {
+      n = EPOXY_SERIAL_TX_BUFFER_SIZE - txEnd;
+    }
+    memcpy(txBuffer + txEnd, buffer + count, n);
+    if (trace) trace->record(EPOXY_TRACE_TX, buffer + count, n);
+    txEnd += n;
+    count += n;
+  }
+  if (isBaudEmulated()) txDroppedCount += size - count;
+  updateEvents();
+
+  if (txLineBuffered && ! writer && memchr(buffer, '\n', count) != nullptr) flush();
+  return count;
+}
+
+int FdSerial::availableForWrite() {
+  if (isBaudEmulated()) {
+    return EPOXY_SERIAL_UART_BUFFER_SIZE - uartTxPending(nowNanos());
+  }
+  if (writer) return writer->available();
+  return EPOXY_SERIAL_TX_BUFFER_SIZE - (txEnd - txStart);
+}
+
+unsigned long FdSerial::getTxDroppedCount() const {
+  return txDroppedCount + (writer ? writer->getDroppedCount() : 0);
+}
+
+//-----------------------------------------------------------------------------
+// Background writer thread
+//-----------------------------------------------------------------------------
+
+bool FdSerial::startWriterThread(EpoxyWriterPolicy policy) {
+  stopWriterThread();
+  if (policy == EPOXY_WRITER_OFF) return true;
+  // The client of a Unix socket comes and goes, so keep it on the event loop.
+  if (outFd < 0 || listenFd >= 0) return false;
+
+  // The writer must not overtake the output which is already buffered.
+  flush();
+  writer = new SerialWriterThread(outFd, policy);
+  if (! writer->start()) {
+    fprintf(stderr,
+        "FdSerial::startWriterThread(): pthread_create() failure\n");
+    delete writer;
+    writer = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void FdSerial::stopWriterThread() {
+  if (! writer) return;
+
+  writer->stop();
+  txDroppedCount += writer->getDroppedCount();
+  delete writer;
+  writer = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Trace and replay
+//-----------------------------------------------------------------------------
+
+bool FdSerial::startTrace(const char* path) {
+  stopTrace();
+  registerAtExit();
+  trace = new SerialTraceWriter();
+  if (! trace->open(path)) {
+    stopTrace();
+    return false;
+  }
+  return true;
+}
+
+void FdSerial::stopTrace() {
+  delete trace;
+  trace = nullptr;
+}
+
+bool FdSerial::startReplay(const char* path, bool realtime) {
+  stopReplay();
+  replay = new SerialTraceReader();
+  if (! replay->open(path, realtime)) {
+    stopReplay();
+    return false;
+  }
+
+  // Discard the input of the fd.
+  rxHead = 0;
+  rxCount = 0;
+  rxArrivedCount = 0;
+  inputEof = false;
+  updateEvents();
+  return true;
+}
+
+void FdSerial::stopReplay() {
+  if (replayTimerId >= 0) {
+    epoxyStopTimer(replayTimerId);
+    replayTimerId = -1;
+  }
+  delete replay;
+  replay = nullptr;
+  inputEof = false;
+  updateEvents();
+}
+
+ssize_t FdSerial::readReplay(uint8_t* buffer, size_t size) {
+  unsigned long waitMicros;
+  size_t n = replay->read(buffer, size, &waitMicros);
+  if (n > 0 || replay->isEof()) return n;
+
+  if (replayTimerId < 0) {
+    replayTimerId = epoxyStartTimer(waitMicros, 0, handleReplayTimer, this);
+  }
+  errno = EAGAIN;
+  return -1;
+}
+
+// Called from yield() or delay() when the next record of the replay is due.
+void FdSerial::handleReplayTimer(void* arg) {
+  FdSerial* serial = (FdSerial*) arg;
+  serial->replayTimerId = -1;
+  serial->fillRx();
+}
+
+//-----------------------------------------------------------------------------
+// Baud rate emulation
+//-----------------------------------------------------------------------------
+
+size_t FdSerial::uartTxPending(uint64_t now) const {
+  if (uartTxDoneNanos <= now) return 0;
+  return (uartTxDoneNanos - now + nanosPerByte - 1) / nanosPerByte;
+}
+
+size_t FdSerial::acquireUartTx(size_t size) {
+  uint64_t now = nowNanos();
+  size_t pending = uartTxPending(now);
+  if (pending >= EPOXY_SERIAL_UART_BUFFER_SIZE
+      && baudEmulation == EPOXY_BAUD_DROP) {
+    return 0;
+  }
+
+  // Wait until a byte leaves the UART buffer, like HardwareSerial::write().
+  while (pending >= EPOXY_SERIAL_UART_BUFFER_SIZE) {
+    uint64_t freeAt = uartTxDoneNanos
+        - (EPOXY_SERIAL_UART_BUFFER_SIZE - 1) * nanosPerByte;
+    unsigned long waitMicros = (freeAt - now + 999) / 1000;
+    delayMicroseconds(waitMicros);
+    txBlockedMicros += waitMicros;
+    now = nowNanos();
+    pending = uartTxPending(now);
+  }
+
+  size_t n = EPOXY_SERIAL_UART_BUFFER_SIZE - pending;
+  if (n > size) n = size;
+
+  if (uartTxDoneNanos < now) uartTxDoneNanos = now;
+  uartTxDoneNanos += n * nanosPerByte;
+  return n;
+}
+
+size_t FdSerial::rxArrived() {
+  if (! isBaudEmulated()) return rxCount;
+
+  // The bytes of the input buffer arrive one at a time at the baud rate. No
+  // credit is accumulated while there is nothing to receive.
+  uint64_t now = nowNanos();
+  if (rxArrivedCount < rxCount) {
+    uint64_t n = (now - rxArrivedNanos) / nanosPerByte;
+    if (rxArrivedCount + n < rxCount) {
+      rxArrivedCount += n;
+      rxArrivedNanos += n * nanosPerByte;
+      return rxArrivedCount;
+    }
+  }
+  rxArrivedCount = rxCount;
+  rxArrivedNanos = now;
+  return rxArrivedCount;
+}
+
+void FdSerial::waitForInput(unsigned long maxMillis) {
+  // The virtual clock is advanced only by yield().
+  if (isVirtualTimeEnabled()) return yield();
+
+  // The event loop also wakes up for the other ports, the timers of a replay,
+  // and the output, so timedRead() checks the input again after it returns.
+  unsigned long waitMicros = maxMillis * 1000;
+  if (rxArrived() < rxCount) {
+    // The next byte of the emulated UART is already in the buffer.
+    unsigned long byteMicros = nanosPerByte / 1000 + 1;
+    if (waitMicros > byteMicros) waitMicros = byteMicros;
+  }
+  epoxyRunEvents(waitMicros);
+}
+
+//-----------------------------------------------------------------------------
+// Devices
+//-----------------------------------------------------------------------------
+
+static bool setNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+bool FdSerial::open(const char* spec) {
+  registerAtExit();
+  close();
+  if (strcmp(spec, "pty") == 0) return openPty();
+  if (strncmp(spec, "fifo:", 5) == 0) return openFifo(spec + 5);
+  if (strncmp(spec, "unix:", 5) == 0) return openUnixSocket(spec + 5);
+
+  fprintf(stderr, "FdSerial::open(): Unknown device '%s'\n", spec);
+  return false;
+}
+
+bool FdSerial::openPty() {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    perror("FdSerial::open(): posix_openpt() failure");
+    if (master >= 0) ::close(master);
+    return false;
+  }
+  snprintf(path, sizeof(path), "%s", ptsname(master));
+
+  // Keep the slave side open, otherwise the master reports POLLHUP on every
+  // poll() until the peripheral simulator opens it. Put it in raw mode, so
+  // that the bytes are passed through unchanged.
+  ptySlaveFd = ::open(path, O_RDWR | O_NOCTTY);
+  struct termios raw;
+  if (ptySlaveFd < 0 || tcgetattr(ptySlaveFd, &raw) != 0) {
+    perror("FdSerial::open(): pty open() failure");
+    ::close(master);
+    close();
+    return false;
+  }
+  cfmakeraw(&raw);
+  tcsetattr(ptySlaveFd, TCSANOW, &raw);
+
+  setNonBlocking(master);
+  setFds(master, master, false);
+  return true;
+}
+
+bool FdSerial::openFifo(const char* base) {
+  char inPath[sizeof(path)];
+  char outPath[sizeof(path)];
+  if (strlen(base) + 5 > sizeof(path)) {
+    fprintf(stderr, "FdSerial::open(): Path too long '%s'\n", base);
+    return false;
+  }
+  snprintf(inPath, sizeof(inPath), "%s.in", base);
+  snprintf(outPath, sizeof(outPath), "%s.out", base);
+
+  if ((mkfifo(inPath, 0666) != 0 && errno != EEXIST)
+      || (mkfifo(outPath, 0666) != 0 && errno != EEXIST)) {
+    perror("FdSerial::open(): mkfifo() failure");
+    return false;
+  }
+
+  // Open both sides for reading and writing, so that opening does not wait
+  // for the peer, and so that the input does not reach EOF when the peer
+  // closes its side. The peer can then reconnect at any time.
+  int in = ::open(inPath, O_RDWR | O_NONBLOCK);
+  int out = ::open(outPath, O_RDWR | O_NONBLOCK);
+  if (in < 0 || out < 0) {
+    perror("FdSerial::open(): fifo open() failure");
+    if (in >= 0) ::close(in);
+    if (out >= 0) ::close(out);
+    return false;
+  }
+
+  snprintf(path, sizeof(path), "%s", base);
+  setFds(in, out, false);
+  return true;
+}
+
+bool FdSerial::openUnixSocket(const char* socketPath) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(socketPath) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "FdSerial::open(): Path too long '%s'\n", socketPath);
+    return false;
+  }
+  strcpy(addr.sun_path, socketPath);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("FdSerial::open(): socket() failure");
+    return false;
+  }
+  unlink(socketPath);
+  if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0
+      || listen(fd, 1) != 0) {
+    perror("FdSerial::open(): bind() failure");
+    ::close(fd);
+    return false;
+  }
+
+  setNonBlocking(fd);
+  snprintf(path, sizeof(path), "%s", socketPath);
+  listenFd = fd;
+  epoxyAddFd(listenFd, POLLIN, handleAccept, this);
+  return true;
+}
+
+// Called from yield() when a client connects to the Unix socket. A new client
+// replaces the previous one.
+void FdSerial::handleAccept(int fd, short /*revents*/, void* arg) {
+  FdSerial* serial = (FdSerial*) arg;
+  int client = accept(fd, nullptr, nullptr);
+  if (client < 0) return;
+  setNonBlocking(client);
+#if defined(SO_NOSIGPIPE)
+  int on = 1;
+  setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+  if (serial->inFd >= 0) {
+    epoxyRemoveFd(serial->inFd);
+    ::close(serial->inFd);
+  }
+  serial->setFds(client, client, false);
+}
+
+void FdSerial::close() {
+  flush();
+  stopWriterThread();
+  if (inFd >= 0) {
+    epoxyRemoveFd(inFd);
+    ::close(inFd);
+  }
+  if (outFd >= 0 && outFd != inFd) {
+    epoxyRemoveFd(outFd);
+    ::close(outFd);
+  }
+  if (ptySlaveFd >= 0) ::close(ptySlaveFd);
+  if (listenFd >= 0) {
+    epoxyRemoveFd(listenFd);
+    ::close(listenFd);
+    unlink(path);
+  }
+
+  inFd = -1;
+  outFd = -1;
+  ptySlaveFd = -1;
+  listenFd = -1;
+  inEvents = 0;
+  outEvents = 0;
+  txStart = 0;
+  txEnd = 0;
+  path[0] = '\0';
+}
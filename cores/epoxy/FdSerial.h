@@ -0,0 +1,374 @@
+/*
+ * Copyright (c) 2026 Brian T. Park
+ * MIT License
+ */
+
+#ifndef EPOXY_DUINO_FD_SERIAL_H
+#define EPOXY_DUINO_FD_SERIAL_H
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint64_t
+#include <sys/types.h> // ssize_t
+#include "Print.h"
+#include "Stream.h"
+
+/** Size of the output buffer of each Serial port. */
+#ifndef EPOXY_SERIAL_TX_BUFFER_SIZE
+  #define EPOXY_SERIAL_TX_BUFFER_SIZE 4096
+#endif
+
+/** Size of the input buffer of each Serial port. */
+#ifndef EPOXY_SERIAL_RX_BUFFER_SIZE
+  #define EPOXY_SERIAL_RX_BUFFER_SIZE 4096
+#endif
+
+/**
+ * Size of the emulated buffer of the UART, used when the baud rate is
+ * emulated. The default is the size of the TX and RX buffers of the AVR core.
+ */
+#ifndef EPOXY_SERIAL_UART_BUFFER_SIZE
+  #define EPOXY_SERIAL_UART_BUFFER_SIZE 64
+#endif
+
+/**
+ * Size of the queue of the background writer thread of each Serial port. Must
+ * be a power of 2.
+ */
+#ifndef EPOXY_SERIAL_WRITER_QUEUE_SIZE
+  #define EPOXY_SERIAL_WRITER_QUEUE_SIZE 65536
+#endif
+
+/** Emulation of the throughput of the baud rate given to `begin()`. */
+enum EpoxyBaudEmulation {
+  /** Transfer the data as fast as possible. This is the default. */
+  EPOXY_BAUD_OFF = 0,
+
+  /** Pace the data, and block `write()` when the UART buffer is full. */
+  EPOXY_BAUD_BLOCK = 1,
+
+  /** Pace the data, and drop the output when the UART buffer is full. */
+  EPOXY_BAUD_DROP = 2,
+};
+
+/**
+ * What the background writer thread does when its queue is full. See
+ * FdSerial::startWriterThread().
+ */
+enum EpoxyWriterPolicy {
+  /** No writer thread. `write()` sends the output itself. */
+  EPOXY_WRITER_OFF = 0,
+
+  /** Block `write()` until the writer makes room in the queue. */
+  EPOXY_WRITER_BLOCK = 1,
+
+  /** Drop the oldest output in the queue, keeping the most recent. */
+  EPOXY_WRITER_DROP_OLDEST = 2,
+
+  /** Drop the new output which does not fit in the queue. */
+  EPOXY_WRITER_DROP_NEWEST = 3,
+};
+
+class SerialWriterThread;
+class SerialTraceWriter;
+class SerialTraceReader;
+
+/**
+ * A Serial port which reads from and writes to Unix file descriptors, using
+ * non-blocking buffered I/O driven by the EpoxyDuino event loop.
+ *
+ * The output is buffered, and is sent when the buffer is full, when `yield()`
+ * finds the output writable, and on `flush()`. If line buffering is enabled,
+ * the output is also sent at the end of each line.
+ *
+ * The input is read in chunks into a ring buffer, when `yield()` finds the
+ * input readable, or when the buffer is less than half full.
+ */
+class FdSerial: public Stream {
+  public:
+    FdSerial() {}
+
+    /** Save the `baud` rate, which is used only if it is emulated. */
+    void begin(unsigned long baud) { setBaud(baud); }
+
+    void begin(unsigned long baud, uint8_t /*config*/) { setBaud(baud); }
+
+    void end() {}
+
+    size_t write(uint8_t c) override;
+
+    size_t write(const uint8_t* buffer, size_t size) override;
+
+    // Pull in all other overloaded versions of the write() function from the
+    // Print parent class. This is required because when we override one version
+    // of write() above, C++ performs a static binding to the write() function
+    // in the current class and doesn't bother searching the parent classes for
+    // any other overloaded function that it could bind to. (30 years of C++ and
+    // I still get shot with C++ footguns like this. I have no idea what happens
+    // if the Stream class overloaded the write() function.)
+    using Print::write;
+
+    /**
+     * Return the free space of the emulated UART buffer if the baud rate is
+     * emulated, otherwise the free space of the output buffer.
+     */
+    int availableForWrite() override;
+
+    operator bool() { return true; }
+
+    /** Return the number of bytes in the input buffer. */
+    int available() override;
+
+    int read() override;
+
+    int peek() override;
+
+    /**
+     * Copy the input buffer in bulk, reading more input from the file
+     * descriptor without waiting. Used by readBytes().
+     */
+    int read(uint8_t* buffer, size_t size) override;
+
+    using Stream::read;
+
+    bool hasPeekBufferAPI() const override { return true; }
+
+    /** Return the number of contiguous bytes of the input buffer. */
+    size_t peekAvailable() override;
+
+    const char* peekBuffer() override { return (const char*) rxBuffer + rxHead; }
+
+    void peekConsume(size_t consume) override;
+
+    /**
+     * Send the buffered output. A blocking port waits until all of it is sent.
+     * A non-blocking port sends only what the output accepts immediately.
+     */
+    void flush() override;
+
+    /**
+     * Send the output at the end of each line, instead of only when the buffer
+     * is full or at `yield()`. This function is available only on EpoxyDuino.
+     */
+    void setLineBuffered(bool lineBuffered) { txLineBuffered = lineBuffered; }
+
+    /**
+     * Connect the port to the device described by `spec`:
+     *
+     *  * `pty`: a new pseudo-terminal, whose path is returned by `getPath()`
+     *  * `fifo:{path}`: the named pipes `{path}.in` (read by the sketch) and
+     *    `{path}.out` (written by the sketch), created if necessary
+     *  * `unix:{path}`: a Unix domain socket listening at `{path}`, which
+     *    accepts one client at a time
+     *
+     * Returns false and prints the reason on STDERR if the device cannot be
+     * opened. This function is available only on EpoxyDuino.
+     */
+    bool open(const char* spec);
+
+    /** Disconnect the port. This function is available only on EpoxyDuino. */
+    void close();
+
+    /**
+     * Return the path of the device given to `open()`, or the path of the
+     * slave side of the pseudo-terminal. Returns an empty string if the port
+     * is not connected. This function is available only on EpoxyDuino.
+     */
+    const char* getPath() const { return path; }
+
+    /**
+     * Emulate the throughput of the baud rate given to `begin()`, assuming 10
+     * bits per byte (8N1). The output goes through an emulated UART buffer of
+     * `EPOXY_SERIAL_UART_BUFFER_SIZE` bytes, which drains at the baud rate.
+     * When it is full, `write()` either waits (EPOXY_BAUD_BLOCK), or drops the
+     * data (EPOXY_BAUD_DROP). The input becomes available at the baud rate.
+     * This can also be set for all ports using the `EPOXY_SERIAL_BAUD`
+     * environment variable set to `block` or `drop`.
+     *
+     * This function is available only on EpoxyDuino.
+     */
+    void setBaudEmulation(EpoxyBaudEmulation mode) { baudEmulation = mode; }
+
+    /**
+     * Total time that `write()` waited for the emulated UART buffer, in
+     * microseconds. Available only on EpoxyDuino.
+     */
+    unsigned long getTxBlockedMicros() const { return txBlockedMicros; }
+
+    /**
+     * Number of bytes dropped by `write()` while the baud rate is emulated, or
+     * by the background writer thread because its queue was full. Available
+     * only on EpoxyDuino.
+     */
+    unsigned long getTxDroppedCount() const;
+
+    /**
+     * Send the output from a background thread, so that `write()` never waits
+     * for a slow consumer of the output (e.g. a pipe to `less` or to a log
+     * collector). The output goes through a lock-free queue of
+     * `EPOXY_SERIAL_WRITER_QUEUE_SIZE` bytes, and `policy` selects what
+     * happens when the queue is full. `flush()` waits until the writer has
+     * sent the queue. The thread is stopped after sending the remaining output
+     * at exit. This can also be set for `Serial` using the
+     * `EPOXY_SERIAL_WRITER` environment variable set to `block`, `drop-oldest`
+     * or `drop-newest`.
+     *
+     * Returns false if the port is not connected, is a Unix socket, or if the
+     * thread cannot be created. This function is available only on EpoxyDuino.
+     */
+    bool startWriterThread(EpoxyWriterPolicy policy);
+
+    /**
+     * Send the remaining output, then stop the background writer thread.
+     * Available only on EpoxyDuino.
+     */
+    void stopWriterThread();
+
+    /**
+     * Record the data read and written by the sketch into the binary trace
+     * file `path`, with the `micros()` timestamp of each chunk. The format is
+     * described in SerialTrace.h. The file is closed at exit. This can also be
+     * set for `Serial` using the `EPOXY_SERIAL_TRACE` environment variable.
+     *
+     * Returns false if the file cannot be created. This function is available
+     * only on EpoxyDuino.
+     */
+    bool startTrace(const char* path);
+
+    /** Close the trace file. Available only on EpoxyDuino. */
+    void stopTrace();
+
+    /**
+     * Replace the input of the port with the RX records of the trace file
+     * `path`, at their original timing relative to this call if `realtime` is
+     * true, otherwise as fast as the sketch reads them. The input reaches the
+     * end of file after the last record. This can also be set for `Serial`
+     * using the `EPOXY_SERIAL_REPLAY` and `EPOXY_SERIAL_REPLAY_SPEED`
+     * environment variables.
+     *
+     * Returns false if the file cannot be read. This function is available
+     * only on EpoxyDuino.
+     */
+    bool startReplay(const char* path, bool realtime);
+
+    /** Go back to the normal input. Available only on EpoxyDuino. */
+    void stopReplay();
+
+  protected:
+    /**
+     * Use the file descriptors `inFd` and `outFd` (which may be the same, or
+     * -1 if unused) for the input and output. If `blockingWrite` is true,
+     * `write()` and `flush()` wait for the output to accept the data.
+     * Otherwise, the data which does not fit in the output buffer is dropped,
+     * like a UART with nothing connected to it.
+     */
+    void setFds(int inFd, int outFd, bool blockingWrite);
+
+    /**
+     * Block in the event loop until the input is readable or `maxMillis`
+     * elapses, instead of waking up every millisecond in yield().
+     */
+    void waitForInput(unsigned long maxMillis) override;
+
+  private:
+    static void handleReady(int fd, short revents, void* arg);
+    static void handleAccept(int fd, short revents, void* arg);
+    static void handleReplayTimer(void* arg);
+
+    /**
+     * Read the input which is due from the replayed trace. Behaves like
+     * `::read()` on a non-blocking fd, and starts a timer for the next record
+     * when it returns EAGAIN.
+     */
+    ssize_t readReplay(uint8_t* buffer, size_t size);
+
+    /** Write as much of the buffer as the output accepts without blocking. */
+    void drainTx();
+
+    /** Read as much of the input as fits in the buffer without blocking. */
+    void fillRx();
+
+    /**
+     * Poll the input while the input buffer has space, and the output while
+     * the output buffer has data.
+     */
+    void updateEvents();
+
+    /** Called when the input reaches the end of file or fails. */
+    void handleInputClosed();
+
+    /** Make room in the output buffer, by waiting or by dropping the data. */
+    void makeTxRoom();
+
+    void setBaud(unsigned long baud) {
+      nanosPerByte = (baud > 0) ? 10000000000ULL / baud : 0;
+    }
+
+    bool isBaudEmulated() const {
+      return baudEmulation != EPOXY_BAUD_OFF && nanosPerByte > 0;
+    }
+
+    /** Number of bytes in the emulated UART buffer waiting to be sent. */
+    size_t uartTxPending(uint64_t now) const;
+
+    /**
+     * Return how many of the `size` bytes can enter the emulated UART buffer,
+     * after waiting if necessary, and account for their transmission time.
+     */
+    size_t acquireUartTx(size_t size);
+
+    /** Number of bytes of the input buffer which have arrived at the baud. */
+    size_t rxArrived();
+
+    /** Consume `n` bytes from the input buffer. */
+    void consumeRx(size_t n);
+
+    bool openPty();
+    bool openFifo(const char* base);
+    bool openUnixSocket(const char* socketPath);
+
+    int inFd = -1;
+    int outFd = -1;
+    int listenFd = -1;
+    int ptySlaveFd = -1;
+    bool blockingWrite = false;
+    short inEvents = 0;
+    short outEvents = 0;
+    char path[108] = "";
+
+    uint8_t rxBuffer[EPOXY_SERIAL_RX_BUFFER_SIZE];
+    size_t rxHead = 0;
+    size_t rxCount = 0;
+    bool inputEof = false;
+
+    // Baud rate emulation. The times are in nanoseconds of micros().
+    EpoxyBaudEmulation baudEmulation = EPOXY_BAUD_OFF;
+    uint64_t nanosPerByte = 0;
+    uint64_t uartTxDoneNanos = 0;
+    size_t rxArrivedCount = 0;
+    uint64_t rxArrivedNanos = 0;
+    unsigned long txBlockedMicros = 0;
+    unsigned long txDroppedCount = 0;
+
+    SerialWriterThread* writer = nullptr;
+    SerialTraceWriter* trace = nullptr;
+    SerialTraceReader* replay = nullptr;
+    int replayTimerId = -1;
+
+    uint8_t txBuffer[EPOXY_SERIAL_TX_BUFFER_SIZE];
+    size_t txStart = 0;
+    size_t txEnd = 0;
+    bool txLineBuffered = false;
+};
+
+// Additional serial ports, connected by the EPOXY_SERIAL1 to EPOXY_SERIAL3
+// environment variables. While a port is not connected, its output is kept
+// until the buffer is full, then dropped.
+#define HAVE_HWSERIAL1
+#define HAVE_HWSERIAL2
+#define HAVE_HWSERIAL3
+
+extern FdSerial Serial1;
+extern FdSerial Serial2;
+extern FdSerial Serial3;
+
+#endif
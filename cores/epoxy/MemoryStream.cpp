@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2026 Brian T. Park
+ * MIT License
+ */
+
+#include <stdlib.h> // realloc(), free()
+#include <string.h> // memcpy(), memmove()
+#include "MemoryStream.h"
+
+MemoryStream::~MemoryStream() {
+  free(buffer);
+}
+
+bool MemoryStream::reserve(size_t size) {
+  if (readPos > 0) {
+    // Move the unread contents to the front, before growing the buffer.
+    memmove(buffer, buffer + readPos, writePos - readPos);
+    writePos -= readPos;
+    readPos = 0;
+  }
+  if (size <= capacity) return true;
+
+  // Keep 1 byte for the NUL terminator of c_str().
+  uint8_t* newBuffer = (uint8_t*) realloc(buffer, size + 1);
+  if (newBuffer == nullptr) return false;
+  buffer = newBuffer;
+  capacity = size;
+  return true;
+}
+
+bool MemoryStream::makeRoom(size_t size) {
+  if (writePos + size <= capacity) return true;
+
+  size_t unread = writePos - readPos;
+  size_t needed = unread + size;
+  // Grow geometrically, so that appending is amortized O(1).
+  size_t newCapacity = capacity ? capacity : 64;
+  while (newCapacity < needed) newCapacity *= 2;
+  // Compacting moves the unread bytes, so grow anyway if it would reclaim
+  // less space than it moves.
+  if (newCapacity == capacity && readPos < unread) newCapacity *= 2;
+  return reserve(newCapacity);
+}
+
+size_t MemoryStream::write(uint8_t c) {
+  if (! makeRoom(1)) return 0;
+  buffer[writePos++] = c;
+  return 1;
+}
+
+size_t MemoryStream::write(const uint8_t* src, size_t size) {
+  if (size == 0) return 0;
+  if (! makeRoom(size)) return 0;
+  memcpy(buffer + writePos, src, size);
+  writePos += size;
+  return size;
+}
+
+int MemoryStream::read() {
+  if (readPos == writePos) return -1;
+  uint8_t c = buffer[readPos++];
+  if (readPos == writePos) clear();
+  return c;
+}
+
+int MemoryStream::peek() {
+  if (readPos == writePos) return -1;
+  return buffer[readPos];
+}
+
+int MemoryStream::read(uint8_t* dest, size_t length) {
+  size_t n = writePos - readPos;
+  if (n > length) n = length;
+  if (n == 0) return 0;
+  memcpy(dest, buffer + readPos, n);
+  peekConsume(n);
+  return n;
+}
+
+void MemoryStream::peekConsume(size_t size) {
+  if (size > writePos - readPos) size = writePos - readPos;
+  readPos += size;
+  if (readPos == writePos) clear();
+}
+
+const char* MemoryStream::c_str() const {
+  if (buffer == nullptr) return "";
+  buffer[writePos] = '\0';
+  return (const char*) buffer + readPos;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2026 Brian T. Park
+ * MIT License
+ */
+
+#ifndef EPOXY_DUINO_MEMORY_STREAM_H
+#define EPOXY_DUINO_MEMORY_STREAM_H
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint8_t
+#include "Print.h"
+#include "Stream.h"
+
+/**
+ * A Stream backed by a growable buffer in memory. The data written to it can
+ * be read back, and the unread contents can be inspected in place with
+ * `data()` and `c_str()`, without copying them. Useful for testing code which
+ * writes to a Print or reads from a Stream, without going through the
+ * syscalls of `Serial`.
+ *
+ * ```C++
+ * MemoryStream stream;
+ * stream.print(42);
+ * assertEqual(stream.c_str(), "42");
+ * ```
+ *
+ * Reading never waits, since no more data can arrive while the caller waits:
+ * the timeout of the Stream starts at 0 instead of 1000 milliseconds, so
+ * `readString()`, `parseInt()` and `find()` also return as soon as the
+ * contents run out. This class is available only on EpoxyDuino.
+ */
+class MemoryStream: public Stream {
+  public:
+    MemoryStream() { setTimeout(0); }
+
+    ~MemoryStream();
+
+    MemoryStream(const MemoryStream&) = delete;
+    MemoryStream& operator=(const MemoryStream&) = delete;
+
+    size_t write(uint8_t c) override;
+
+    size_t write(const uint8_t* buffer, size_t size) override;
+
+    using Print::write;
+
+    int availableForWrite() override { return 0x7FFF; }
+
+    int available() override { return writePos - readPos; }
+
+    int read() override;
+
+    int peek() override;
+
+    /** Copy the unread contents in bulk. */
+    int read(uint8_t* buffer, size_t size) override;
+
+    using Stream::read;
+
+    /** Same as `read(buffer, length)`. Returns immediately. */
+    size_t readBytes(char* buffer, size_t length) override {
+      return read((uint8_t*) buffer, length);
+    }
+
+    using Stream::readBytes;
+
+    /** Pointer to the unread contents. Valid until the next write. */
+    const uint8_t* data() const { return buffer + readPos; }
+
+    /**
+     * The unread contents as a NUL-terminated string. Valid until the next
+     * write.
+     */
+    const char* c_str() const;
+
+    /** Number of unread bytes. Same as `available()`. */
+    size_t size() const { return writePos - readPos; }
+
+    /** Discard the contents. The buffer is kept for reuse. */
+    void clear() { readPos = writePos = 0; }
+
+    /** Grow the buffer to hold at least `size` unread bytes. */
+    bool reserve(size_t size);
+
+    bool hasPeekBufferAPI() const override { return true; }
+
+    /** Number of unread bytes which `peekBuffer()` returns. */
+    size_t peekAvailable() override { return size(); }
+
+    /** Pointer to the unread contents, same as `data()`. */
+    const char* peekBuffer() override { return (const char*) data(); }
+
+    /** Discard `size` bytes which were inspected using `peekBuffer()`. */
+    void peekConsume(size_t size) override;
+
+  private:
+    /** Make room to append `size` bytes. Returns false if out of memory. */
+    bool makeRoom(size_t size);
+
+    uint8_t* buffer = nullptr;
+    size_t capacity = 0;
+    size_t readPos = 0;
+    size_t writePos = 0;
+};
+
+#endif
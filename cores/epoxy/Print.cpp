@@ -23,14 +23,835 @@
 */
 
 #include <stdlib.h>
-#include <stdio.h> // vsnprintf
-#include <stdarg.h> // va_list, va_start()
-#include <math.h> // isnan(), isinf()
+#include <stdint.h> // intmax_t, uintptr_t
+#include <stdio.h> // snprintf()
+#include <stdarg.h> // va_list, va_start(), va_copy()
+#include <wchar.h> // wint_t, wcrtomb()
+#include <limits.h> // MB_LEN_MAX
+#include <math.h> // isnan(), isinf(), isfinite()
+#include <string.h> // memcpy(), memset(), strlen()
+#include <limits> // std::numeric_limits
+#include <type_traits> // std::make_unsigned
 #include "pgmspace.h"
 #include "Print.h"
 
-// Size of the internal printf() buffer
-#define PRINTF_BUFFER_SIZE 250
+using epoxy_print::PrintBuffer;
+using epoxy_print::appendNumber;
+using epoxy_print::appendFloat;
+
+namespace {
+
+// Pairs of decimal digits from "00" to "99".
+const char kDecimalPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Digits of any base up to 36.
+const char kDigits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+// Powers of 10 which fit in 64 bits.
+const uint64_t kPow10U64[20] = {
+  1ULL,
+  10ULL,
+  100ULL,
+  1000ULL,
+  10000ULL,
+  100000ULL,
+  1000000ULL,
+  10000000ULL,
+  100000000ULL,
+  1000000000ULL,
+  10000000000ULL,
+  100000000000ULL,
+  1000000000000ULL,
+  10000000000000ULL,
+  100000000000000ULL,
+  1000000000000000ULL,
+  10000000000000000ULL,
+  100000000000000000ULL,
+  1000000000000000000ULL,
+  10000000000000000000ULL,
+};
+
+/**
+ * Format `n` backwards, ending just before `end`. Returns the first digit.
+ * Declared inline so that the compiler still inlines it into appendNumber()
+ * now that it has several callers.
+ */
+inline char* formatDecimal(unsigned long long n, char* end)
+{
+  // Two digits per division, which the compiler turns into a multiplication.
+  while (n >= 100) {
+    const char* pair = &kDecimalPairs[(n % 100) * 2];
+    n /= 100;
+    *--end = pair[1];
+    *--end = pair[0];
+  }
+  if (n >= 10) {
+    const char* pair = &kDecimalPairs[n * 2];
+    *--end = pair[1];
+    *--end = pair[0];
+  } else {
+    *--end = '0' + n;
+  }
+  return end;
+}
+
+char* formatHex(unsigned long long n, char* end, const char* digits = kDigits)
+{
+  do {
+    *--end = digits[n & 0xF];
+    n >>= 4;
+  } while (n);
+  return end;
+}
+
+char* formatOtherBase(unsigned long long n, uint8_t base, char* end)
+{
+  if ((base & (base - 1)) == 0) {
+    // Power of 2, so shift instead of dividing.
+    uint8_t shift = __builtin_ctz(base);
+    unsigned long long mask = base - 1;
+    do {
+      *--end = kDigits[n & mask];
+      n >>= shift;
+    } while (n);
+  } else {
+    do {
+      *--end = kDigits[n % base];
+      n /= base;
+    } while (n);
+  }
+  return end;
+}
+
+/** Print the signed integer `n` of type T in the given `base`. */
+template <typename T>
+void appendSigned(PrintBuffer& out, T n, int base)
+{
+  typedef typename std::make_unsigned<T>::type U;
+
+  if (base == 0) {
+    out.append((char) n);
+  } else if (base == 10 && n < 0) {
+    out.append('-');
+    // Negate as unsigned to handle the minimum value.
+    appendNumber(out, 0 - (U) n, 10);
+  } else {
+    // Other bases print the two's complement of the type.
+    appendNumber(out, (U) n, base);
+  }
+}
+
+void appendUnsigned(PrintBuffer& out, unsigned long long n, int base)
+{
+  if (base == 0) out.append((char) n);
+  else appendNumber(out, n, base);
+}
+
+/**
+ * An unsigned integer large enough to hold any double multiplied by 10^255,
+ * for the exact conversion of the doubles which do not fit in 64 bits.
+ */
+class BigUnsigned {
+  public:
+    explicit BigUnsigned(uint64_t n) {
+      limbs[0] = (uint32_t) n;
+      limbs[1] = (uint32_t) (n >> 32);
+      size = (limbs[1] != 0) ? 2 : (limbs[0] != 0) ? 1 : 0;
+    }
+
+    bool isZero() const { return size == 0; }
+
+    void multiply(uint32_t k) {
+      uint64_t carry = 0;
+      for (size_t i = 0; i < size; i++) {
+        carry += (uint64_t) limbs[i] * k;
+        limbs[i] = (uint32_t) carry;
+        carry >>= 32;
+      }
+      if (carry) limbs[size++] = (uint32_t) carry;
+    }
+
+    void multiplyPow10(uint8_t exponent) {
+      for (; exponent >= 9; exponent -= 9) multiply(1000000000);
+      multiply((uint32_t) kPow10U64[exponent]);
+    }
+
+    void shiftLeft(unsigned bits) {
+      if (size == 0) return;
+      size_t words = bits / 32;
+      unsigned shift = bits % 32;
+      limbs[size] = 0;
+      for (size_t i = size + 1; i-- > 0; ) {
+        uint32_t lower = (shift && i > 0) ? limbs[i - 1] >> (32 - shift) : 0;
+        limbs[i + words] = (limbs[i] << shift) | lower;
+      }
+      memset(limbs, 0, words * sizeof(uint32_t));
+      size += words + 1;
+      trim();
+    }
+
+    /**
+     * Shift right by `bits`, rounding the exact quotient half away from zero.
+     */
+    void shiftRightRound(unsigned bits) {
+      size_t words = bits / 32;
+      unsigned shift = bits % 32;
+      bool roundUp = bit(bits - 1);
+      if (words >= size) {
+        size = 0;
+      } else {
+        for (size_t i = 0; i + words < size; i++) {
+          uint32_t upper = (shift && i + words + 1 < size)
+              ? limbs[i + words + 1] << (32 - shift) : 0;
+          limbs[i] = (limbs[i + words] >> shift) | upper;
+        }
+        size -= words;
+        trim();
+      }
+      if (roundUp) increment();
+    }
+
+    /** Divide by `k` in place, and return the remainder. */
+    uint32_t divide(uint32_t k) {
+      uint64_t rem = 0;
+      for (size_t i = size; i-- > 0; ) {
+        rem = (rem << 32) | limbs[i];
+        limbs[i] = (uint32_t) (rem / k);
+        rem %= k;
+      }
+      trim();
+      return (uint32_t) rem;
+    }
+
+  private:
+    // 2^1024 * 10^255 < 2^1872
+    static const size_t kMaxLimbs = 60;
+
+    bool bit(unsigned n) const {
+      size_t i = n / 32;
+      return i < size && ((limbs[i] >> (n % 32)) & 1);
+    }
+
+    void increment() {
+      for (size_t i = 0; i < size; i++) {
+        if (++limbs[i] != 0) return;
+      }
+      limbs[size++] = 1;
+    }
+
+    void trim() {
+      while (size > 0 && limbs[size - 1] == 0) size--;
+    }
+
+    uint32_t limbs[kMaxLimbs + 1];
+    size_t size;
+};
+
+/**
+ * Append the decimal digits from `str` to `end`, which are the number times
+ * 10^digits, with the decimal point inserted before the last `digits` digits.
+ */
+void appendFixed(PrintBuffer& out, const char* str, const char* end,
+    uint8_t digits)
+{
+  size_t len = end - str;
+  if (len <= digits) {
+    out.append('0');
+  } else {
+    out.append(str, len - digits);
+  }
+  if (digits == 0) return;
+
+  out.append('.');
+  for (size_t i = len; i < digits; i++) out.append('0');
+  size_t frac = (len < digits) ? len : digits;
+  out.append(end - frac, frac);
+}
+
+/** Convert `m * 2^exponent * 10^digits` exactly, using a BigUnsigned. */
+void appendFloatExact(PrintBuffer& out, uint64_t m, int exponent,
+    uint8_t digits)
+{
+  BigUnsigned n(m);
+  n.multiplyPow10(digits);
+  if (exponent >= 0) {
+    n.shiftLeft(exponent);
+  } else {
+    n.shiftRightRound(-exponent);
+  }
+
+  // 309 digits for DBL_MAX, plus 255 fraction digits.
+  char buf[576];
+  char* end = &buf[sizeof(buf)];
+  char* str = end;
+  while (true) {
+    uint32_t chunk = n.divide(1000000000);
+    if (n.isZero()) {
+      str = formatDecimal(chunk, str);
+      break;
+    }
+    for (int i = 0; i < 9; i++) {
+      *--str = '0' + chunk % 10;
+      chunk /= 10;
+    }
+  }
+  appendFixed(out, str, end, digits);
+}
+
+// printf() engine ///////////////////////////////////////////////////////////
+
+// Lower case digits for %x.
+const char kLowerDigits[] = "0123456789abcdef";
+
+/** The flags, width and precision of a printf() conversion. */
+struct FormatSpec {
+  bool left = false; // '-'
+  bool plus = false; // '+'
+  bool space = false; // ' '
+  bool alternate = false; // '#'
+  bool zero = false; // '0'
+  int width = 0;
+  int precision = -1; // not given
+};
+
+/** The length modifier of a printf() conversion. */
+enum FormatLength {
+  kLengthNone,
+  kLengthChar, // hh
+  kLengthShort, // h
+  kLengthLong, // l
+  kLengthLongLong, // ll
+  kLengthIntMax, // j
+  kLengthSize, // z
+  kLengthPtrDiff, // t
+  kLengthLongDouble, // L
+};
+
+void appendRepeated(PrintBuffer& out, char c, int count)
+{
+  while (count-- > 0) out.append(c);
+}
+
+/**
+ * Append `prefix`, then `zeros` zeros, then `body`, padded to the width of
+ * `spec`. The '0' flag pads with zeros between the prefix and the body.
+ */
+void appendPadded(PrintBuffer& out, const FormatSpec& spec,
+    const char* prefix, size_t prefixSize, int zeros,
+    const char* body, size_t size)
+{
+  int padding = spec.width - (int) (prefixSize + zeros + size);
+  if (padding < 0) padding = 0;
+  if (! spec.left) {
+    if (spec.zero) {
+      zeros += padding;
+    } else {
+      appendRepeated(out, ' ', padding);
+    }
+  }
+  out.appendShort(prefix, prefixSize);
+  appendRepeated(out, '0', zeros);
+  out.append(body, size);
+  if (spec.left) appendRepeated(out, ' ', padding);
+}
+
+/** Append the integer conversion `c` of `n`, with the `sign` if not 0. */
+void appendInteger(PrintBuffer& out, FormatSpec spec, char c,
+    unsigned long long n, char sign)
+{
+  char buf[8 * sizeof(long long)];
+  char* end = &buf[sizeof(buf)];
+  char* str = end;
+  // An explicit precision of 0 prints nothing for 0.
+  if (n != 0 || spec.precision != 0) {
+    if (c == 'x') {
+      str = formatHex(n, end, kLowerDigits);
+    } else if (c == 'X') {
+      str = formatHex(n, end, kDigits);
+    } else if (c == 'o') {
+      str = formatOtherBase(n, 8, end);
+    } else {
+      str = formatDecimal(n, end);
+    }
+  }
+  size_t size = end - str;
+
+  char prefix[2];
+  size_t prefixSize = 0;
+  if (sign) prefix[prefixSize++] = sign;
+  if (spec.alternate && (c == 'x' || c == 'X') && n != 0) {
+    prefix[prefixSize++] = '0';
+    prefix[prefixSize++] = c;
+  }
+
+  int zeros = 0;
+  if (spec.precision >= 0) {
+    if (spec.precision > (int) size) zeros = spec.precision - size;
+    spec.zero = false;
+  }
+  if (spec.alternate && c == 'o' && zeros == 0 && (size == 0 || *str != '0')) {
+    // Force a leading zero.
+    zeros = 1;
+  }
+  appendPadded(out, spec, prefix, prefixSize, zeros, str, size);
+}
+
+/** Build the snprintf() format of a conversion, with '*' for the numbers. */
+void buildFormat(char* format, const FormatSpec& spec, const char* length,
+    char c)
+{
+  *format++ = '%';
+  if (spec.left) *format++ = '-';
+  if (spec.plus) *format++ = '+';
+  if (spec.space) *format++ = ' ';
+  if (spec.alternate) *format++ = '#';
+  if (spec.zero) *format++ = '0';
+  *format++ = '*';
+  *format++ = '.';
+  *format++ = '*';
+  while (*length) *format++ = *length++;
+  *format++ = c;
+  *format = '\0';
+}
+
+/**
+ * Append the multibyte form of the wide string `s` for %ls. The precision
+ * limits the number of bytes, without splitting a character. Nothing is
+ * appended if a character cannot be converted, like snprintf().
+ */
+void appendWideString(PrintBuffer& out, const FormatSpec& spec,
+    const wchar_t* s)
+{
+  if (s == nullptr) s = L"(null)";
+
+  // Count the bytes first, for the padding.
+  char mb[MB_LEN_MAX];
+  mbstate_t state;
+  memset(&state, 0, sizeof(state));
+  size_t size = 0;
+  const wchar_t* end = s;
+  for (; *end; end++) {
+    size_t n = wcrtomb(mb, *end, &state);
+    if (n == (size_t) -1) return;
+    if (spec.precision >= 0 && size + n > (size_t) spec.precision) break;
+    size += n;
+  }
+
+  int padding = spec.width - (int) size;
+  if (! spec.left) appendRepeated(out, ' ', padding);
+  memset(&state, 0, sizeof(state));
+  for (const wchar_t* p = s; p < end; p++) {
+    out.appendShort(mb, wcrtomb(mb, *p, &state));
+  }
+  if (spec.left) appendRepeated(out, ' ', padding);
+}
+
+/** Append the multibyte form of the wide character `c` for %lc. */
+void appendWideChar(PrintBuffer& out, const FormatSpec& spec, wint_t c)
+{
+  char mb[MB_LEN_MAX];
+  mbstate_t state;
+  memset(&state, 0, sizeof(state));
+  size_t n = wcrtomb(mb, (wchar_t) c, &state);
+  if (n == (size_t) -1) return;
+  appendPadded(out, spec, nullptr, 0, 0, mb, n);
+}
+
+/**
+ * Append the digits of a floating point conversion, which snprintf() wrote
+ * to `body` without a width, followed by `extra` zeros of the precision, and
+ * padded to the width of `spec`. The '0' flag pads with zeros after the sign
+ * and the "0x" of %a.
+ */
+void appendFloatBody(PrintBuffer& out, const FormatSpec& spec, char c,
+    const char* body, size_t size, int extra, bool finite)
+{
+  size_t prefixSize = 0;
+  if (size > 0 && (*body == '-' || *body == '+' || *body == ' ')) {
+    prefixSize = 1;
+  }
+  bool hex = (c == 'a' || c == 'A');
+  if (hex && finite && size >= prefixSize + 2) prefixSize += 2;
+
+  // The extra zeros go before the exponent.
+  const char* end = body + size;
+  const char* exponent = body + prefixSize;
+  while (exponent < end && *exponent != (hex ? 'p' : 'e')
+      && *exponent != (hex ? 'P' : 'E')) {
+    exponent++;
+  }
+
+  int padding = spec.width - (int) size - extra;
+  bool zeroPad = spec.zero && finite;
+  if (! spec.left && ! zeroPad) appendRepeated(out, ' ', padding);
+  out.appendShort(body, prefixSize);
+  if (zeroPad) appendRepeated(out, '0', padding);
+  out.append(body + prefixSize, exponent - (body + prefixSize));
+  appendRepeated(out, '0', extra);
+  out.append(exponent, end - exponent);
+  if (spec.left) appendRepeated(out, ' ', padding);
+}
+
+/**
+ * Limits of the floating point type T for snprintf(). The smallest subnormal
+ * has `kMaxPrecision` digits after the decimal point, so a larger precision
+ * only adds zeros. Without a width, the output is at most `kMaxSize` bytes:
+ * the sign, the integer digits, the point, the fraction and the exponent.
+ */
+template <typename T>
+struct FloatLimits {
+  static const int kMaxPrecision =
+      std::numeric_limits<T>::digits - std::numeric_limits<T>::min_exponent;
+  static const int kMaxSize =
+      std::numeric_limits<T>::max_exponent10 + kMaxPrecision + 16;
+};
+
+/** Like appendFloatConversion(), for the output which exceeds 128 bytes. */
+template <typename T>
+__attribute__((noinline))
+void appendLargeFloat(PrintBuffer& out, const FormatSpec& spec, char c,
+    const char* format, int precision, int extra, T value)
+{
+  char buf[FloatLimits<T>::kMaxSize];
+  int n = snprintf(buf, sizeof(buf), format, 0, precision, value);
+  if (n < 0) return;
+  if ((size_t) n >= sizeof(buf)) n = sizeof(buf) - 1;
+  appendFloatBody(out, spec, c, buf, n, extra, isfinite(value));
+}
+
+/**
+ * Append the floating point conversion `c` of `value`, formatted by
+ * snprintf(). The width and the precision beyond the exact digits of the
+ * value are added here, so the output of snprintf() is bounded by the type,
+ * and fits a buffer on the stack.
+ */
+template <typename T>
+void appendFloatConversion(PrintBuffer& out, const FormatSpec& spec,
+    const char* length, char c, T value)
+{
+  FormatSpec digitSpec = spec;
+  digitSpec.left = false;
+  digitSpec.zero = false;
+  char format[16];
+  buildFormat(format, digitSpec, length, c);
+
+  // %g without '#' removes the trailing zeros, so they are not added back.
+  int precision = spec.precision;
+  int extra = 0;
+  if (precision > FloatLimits<T>::kMaxPrecision && isfinite(value)) {
+    if ((c != 'g' && c != 'G') || spec.alternate) {
+      extra = precision - FloatLimits<T>::kMaxPrecision;
+    }
+    precision = FloatLimits<T>::kMaxPrecision;
+  }
+
+  char buf[128];
+  int n = snprintf(buf, sizeof(buf), format, 0, precision, value);
+  if (n < 0) return;
+  if ((size_t) n < sizeof(buf)) {
+    appendFloatBody(out, spec, c, buf, n, extra, isfinite(value));
+  } else {
+    appendLargeFloat(out, spec, c, format, precision, extra, value);
+  }
+}
+
+/** Fetch a signed integer argument of the given `length`. */
+long long fetchSigned(FormatLength length, va_list& args)
+{
+  switch (length) {
+    case kLengthChar: return (signed char) va_arg(args, int);
+    case kLengthShort: return (short) va_arg(args, int);
+    case kLengthLong: return va_arg(args, long);
+    case kLengthLongLong: return va_arg(args, long long);
+    case kLengthIntMax: return va_arg(args, intmax_t);
+    case kLengthSize: return va_arg(args, std::make_signed<size_t>::type);
+    case kLengthPtrDiff: return va_arg(args, ptrdiff_t);
+    default: return va_arg(args, int);
+  }
+}
+
+/** Fetch an unsigned integer argument of the given `length`. */
+unsigned long long fetchUnsigned(FormatLength length, va_list& args)
+{
+  switch (length) {
+    case kLengthChar: return (unsigned char) va_arg(args, unsigned);
+    case kLengthShort: return (unsigned short) va_arg(args, unsigned);
+    case kLengthLong: return va_arg(args, unsigned long);
+    case kLengthLongLong: return va_arg(args, unsigned long long);
+    case kLengthIntMax: return va_arg(args, uintmax_t);
+    case kLengthSize: return va_arg(args, size_t);
+    case kLengthPtrDiff:
+      return va_arg(args, std::make_unsigned<ptrdiff_t>::type);
+    default: return va_arg(args, unsigned);
+  }
+}
+
+/** Store the number of characters so far for %n. */
+void storeCount(FormatLength length, va_list& args, size_t count)
+{
+  switch (length) {
+    case kLengthChar: *va_arg(args, signed char*) = count; break;
+    case kLengthShort: *va_arg(args, short*) = count; break;
+    case kLengthLong: *va_arg(args, long*) = count; break;
+    case kLengthLongLong: *va_arg(args, long long*) = count; break;
+    case kLengthIntMax: *va_arg(args, intmax_t*) = count; break;
+    case kLengthSize: *va_arg(args, size_t*) = count; break;
+    case kLengthPtrDiff: *va_arg(args, ptrdiff_t*) = count; break;
+    default: *va_arg(args, int*) = count; break;
+  }
+}
+
+/**
+ * Format the arguments like vprintf() directly into `out`, without a limit
+ * on the length of the output. The integer, string and character conversions
+ * are done here; the floating point conversions use snprintf() one at a time.
+ */
+void appendFormat(PrintBuffer& out, const char* format, va_list& args)
+{
+  while (true) {
+    const char* percent = strchr(format, '%');
+    if (percent == nullptr) return out.append(format);
+    out.append(format, percent - format);
+
+    const char* p = percent + 1;
+    FormatSpec spec;
+    for (;; p++) {
+      if (*p == '-') spec.left = true;
+      else if (*p == '+') spec.plus = true;
+      else if (*p == ' ') spec.space = true;
+      else if (*p == '#') spec.alternate = true;
+      else if (*p == '0') spec.zero = true;
+      else break;
+    }
+
+    if (*p == '*') {
+      spec.width = va_arg(args, int);
+      if (spec.width < 0) {
+        spec.left = true;
+        spec.width = -spec.width;
+      }
+      p++;
+    } else {
+      while (*p >= '0' && *p <= '9') spec.width = spec.width * 10 + *p++ - '0';
+    }
+
+    if (*p == '.') {
+      p++;
+      if (*p == '*') {
+        spec.precision = va_arg(args, int);
+        if (spec.precision < 0) spec.precision = -1;
+        p++;
+      } else {
+        spec.precision = 0;
+        while (*p >= '0' && *p <= '9') {
+          spec.precision = spec.precision * 10 + *p++ - '0';
+        }
+      }
+    }
+    if (spec.left) spec.zero = false;
+
+    FormatLength length = kLengthNone;
+    const char* lengthStart = p;
+    switch (*p) {
+      case 'h':
+        p++;
+        if (*p == 'h') { p++; length = kLengthChar; }
+        else length = kLengthShort;
+        break;
+      case 'l':
+        p++;
+        if (*p == 'l') { p++; length = kLengthLongLong; }
+        else length = kLengthLong;
+        break;
+      case 'j': p++; length = kLengthIntMax; break;
+      case 'z': p++; length = kLengthSize; break;
+      case 't': p++; length = kLengthPtrDiff; break;
+      case 'L': p++; length = kLengthLongDouble; break;
+    }
+
+    char c = *p;
+    if (c == '\0') {
+      // Incomplete conversion at the end of the format.
+      return out.append(percent, p - percent);
+    }
+    format = p + 1;
+
+    switch (c) {
+      case 'd':
+      case 'i': {
+        long long n = fetchSigned(length, args);
+        char sign = (n < 0) ? '-' : spec.plus ? '+' : spec.space ? ' ' : 0;
+        // Negate as unsigned to handle the minimum value.
+        unsigned long long magnitude = (n < 0)
+            ? 0 - (unsigned long long) n : (unsigned long long) n;
+        appendInteger(out, spec, 'd', magnitude, sign);
+        break;
+      }
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X':
+        appendInteger(out, spec, c, fetchUnsigned(length, args), 0);
+        break;
+      case 'p': {
+        void* ptr = va_arg(args, void*);
+        if (ptr == nullptr) {
+          spec.zero = false;
+          appendPadded(out, spec, nullptr, 0, 0, "(nil)", 5);
+        } else {
+          spec.alternate = true;
+          appendInteger(out, spec, 'x', (uintptr_t) ptr, 0);
+        }
+        break;
+      }
+      case 'c':
+        spec.zero = false;
+        if (length == kLengthLong) {
+          appendWideChar(out, spec, va_arg(args, wint_t));
+        } else {
+          char ch = (char) va_arg(args, int);
+          appendPadded(out, spec, nullptr, 0, 0, &ch, 1);
+        }
+        break;
+      case 's':
+        spec.zero = false;
+        if (length == kLengthLong) {
+          appendWideString(out, spec, va_arg(args, const wchar_t*));
+        } else {
+          const char* s = va_arg(args, const char*);
+          if (s == nullptr) s = "(null)";
+          size_t size = (spec.precision >= 0)
+              ? strnlen(s, spec.precision) : strlen(s);
+          appendPadded(out, spec, nullptr, 0, 0, s, size);
+        }
+        break;
+      case 'f':
+      case 'F':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A': {
+        char lengthChars[3] = {0};
+        memcpy(lengthChars, lengthStart, p - lengthStart);
+        if (length == kLengthLongDouble) {
+          appendFloatConversion(out, spec, lengthChars, c,
+              va_arg(args, long double));
+        } else {
+          appendFloatConversion(out, spec, lengthChars, c,
+              va_arg(args, double));
+        }
+        break;
+      }
+      case 'n':
+        storeCount(length, args, out.size());
+        break;
+      case '%':
+        out.append('%');
+        break;
+      default:
+        // Unknown conversion, printed as is.
+        out.append(percent, format - percent);
+        break;
+    }
+  }
+}
+
+} // namespace
+
+namespace epoxy_print {
+
+void appendNumber(PrintBuffer& out, unsigned long long n, uint8_t base)
+{
+  char buf[8 * sizeof(long long)]; // Assumes 8-bit chars.
+  char* end = &buf[sizeof(buf)];
+  char* str;
+
+  // prevent crash if called with base == 1, and stay within kDigits
+  if (base < 2 || base > 36) base = 10;
+
+  if (base == 10) {
+    str = formatDecimal(n, end);
+  } else if (base == 16) {
+    str = formatHex(n, end);
+  } else {
+    str = formatOtherBase(n, base, end);
+  }
+  out.appendShort(str, end - str);
+}
+
+/**
+ * Print `number` with `digits` digits after the decimal point. The conversion
+ * uses the exact binary value of the double, so the output is correctly
+ * rounded over the whole range, with ties rounded away from zero.
+ */
+void appendFloat(PrintBuffer& out, double number, uint8_t digits)
+{
+  if (isnan(number)) return out.append("nan");
+  if (isinf(number)) return out.append("inf");
+
+  // Handle negative numbers
+  if (number < 0.0)
+  {
+     out.append('-');
+     number = -number;
+  }
+
+  // Split into the integer m and the exponent, number = m * 2^exponent.
+  uint64_t bits;
+  memcpy(&bits, &number, sizeof(bits));
+  int biased = (int) ((bits >> 52) & 0x7FF); // without the sign of -0.0
+  uint64_t m = bits & ((1ULL << 52) - 1);
+  int exponent;
+  if (biased == 0) {
+    exponent = -1074; // subnormal
+  } else {
+    m |= 1ULL << 52;
+    exponent = biased - 1075;
+  }
+
+  // Fast path with 128-bit integers: the number times 10^digits, rounded, in
+  // 64 bits. Covers the fractions and the integers below 2^64.
+  if (digits < 20 && exponent < 0) {
+    unsigned shift = -exponent;
+    unsigned __int128 scaled = (unsigned __int128) m * kPow10U64[digits];
+    unsigned long long n = 0;
+    bool fits = true;
+    if (shift < 128) {
+      unsigned __int128 q = scaled >> shift;
+      bool roundUp = (scaled >> (shift - 1)) & 1;
+      q += roundUp;
+      fits = (q >> 64) == 0;
+      n = (unsigned long long) q;
+    }
+    if (fits) {
+      char buf[24];
+      char* end = &buf[sizeof(buf)];
+      appendFixed(out, formatDecimal(n, end), end, digits);
+      return;
+    }
+  } else if (exponent >= 0 && exponent <= 11) {
+    appendNumber(out, m << exponent, 10);
+    if (digits > 0) out.append('.');
+    while (digits-- > 0) out.append('0');
+    return;
+  }
+
+  appendFloatExact(out, m, exponent, digits);
+}
+
+} // epoxy_print
 
 // Public Methods //////////////////////////////////////////////////////////////
 
@@ -47,15 +868,9 @@ size_t Print::write(const uint8_t *buffer, size_t size)
 
 size_t Print::print(const __FlashStringHelper *ifsh)
 {
+  // Flash memory is ordinary memory on EpoxyDuino, so write it in bulk.
   PGM_P p = reinterpret_cast<PGM_P>(ifsh);
-  size_t n = 0;
-  while (1) {
-    unsigned char c = pgm_read_byte(p++);
-    if (c == 0) break;
-    if (write(c)) n++;
-    else break;
-  }
-  return n;
+  return write(p, strlen_P(p));
 }
 
 size_t Print::print(const String &s)
@@ -90,24 +905,30 @@ size_t Print::print(unsigned int n, int base)
 
 size_t Print::print(long n, int base)
 {
-  if (base == 0) {
-    return write(n);
-  } else if (base == 10) {
-    if (n < 0) {
-      int t = print('-');
-      n = -n;
-      return printNumber(n, 10) + t;
-    }
-    return printNumber(n, 10);
-  } else {
-    return printNumber(n, base);
-  }
+  PrintBuffer out(*this);
+  appendSigned(out, n, base);
+  return out.finish();
 }
 
 size_t Print::print(unsigned long n, int base)
 {
-  if (base == 0) return write(n);
-  else return printNumber(n, base);
+  PrintBuffer out(*this);
+  appendUnsigned(out, n, base);
+  return out.finish();
+}
+
+size_t Print::print(long long n, int base)
+{
+  PrintBuffer out(*this);
+  appendSigned(out, n, base);
+  return out.finish();
+}
+
+size_t Print::print(unsigned long long n, int base)
+{
+  PrintBuffer out(*this);
+  appendUnsigned(out, n, base);
+  return out.finish();
 }
 
 size_t Print::print(double n, int digits)
@@ -117,9 +938,11 @@ size_t Print::print(double n, int digits)
 
 size_t Print::println(const __FlashStringHelper *ifsh)
 {
-  size_t n = print(ifsh);
-  n += println();
-  return n;
+  PGM_P p = reinterpret_cast<PGM_P>(ifsh);
+  PrintBuffer out(*this);
+  out.append(p, strlen_P(p));
+  out.appendShort(lineEnding(), lineEndingSize());
+  return out.finish();
 }
 
 size_t Print::print(const Printable& x)
@@ -129,74 +952,86 @@ size_t Print::print(const Printable& x)
 
 size_t Print::println(void)
 {
-  if (isLineModeUnix) {
-    return write('\n');
-  } else {
-    return write("\r\n");
-  }
+  return write(lineEnding(), lineEndingSize());
 }
 
 size_t Print::println(const String &s)
 {
-  size_t n = print(s);
-  n += println();
-  return n;
+  PrintBuffer out(*this);
+  out.append(s.c_str(), s.length());
+  out.appendShort(lineEnding(), lineEndingSize());
+  return out.finish();
 }
 
 size_t Print::println(const char c[])
 {
-  size_t n = print(c);
-  n += println();
-  return n;
+  PrintBuffer out(*this);
+  if (c != NULL) out.append(c);
+  out.appendShort(lineEnding(), lineEndingSize());
+  return out.finish();
 }
 
 size_t Print::println(char c)
 {
-  size_t n = print(c);
-  n += println();
-  return n;
+  PrintBuffer out(*this);
+  out.append(c);
+  out.appendShort(lineEnding(), lineEndingSize());
+  return out.finish();
 }
 
 size_t Print::println(unsigned char b, int base)
 {
-  size_t n = print(b, base);
-  n += println();
-  return n;
+  return println((unsigned long) b, base);
 }
 
 size_t Print::println(int num, int base)
 {
-  size_t n = print(num, base);
-  n += println();
-  return n;
+  return println((long) num, base);
 }
 
 size_t Print::println(unsigned int num, int base)
 {
-  size_t n = print(num, base);
-  n += println();
-  return n;
+  return println((unsigned long) num, base);
 }
 
 size_t Print::println(long num, int base)
 {
-  size_t n = print(num, base);
-  n += println();
-  return n;
+  PrintBuffer out(*this);
+  appendSigned(out, num, base);
+  out.appendShort(lineEnding(), lineEndingSize());
+  return out.finish();
 }
 
 size_t Print::println(unsigned long num, int base)
 {
-  size_t n = print(num, base);
-  n += println();
-  return n;
+  PrintBuffer out(*this);
+  appendUnsigned(out, num, base);
+  out.appendShort(lineEnding(), lineEndingSize());
+  return out.finish();
+}
+
+size_t Print::println(long long num, int base)
+{
+  PrintBuffer out(*this);
+  appendSigned(out, num, base);
+  out.appendShort(lineEnding(), lineEndingSize());
+  return out.finish();
+}
+
+size_t Print::println(unsigned long long num, int base)
+{
+  PrintBuffer out(*this);
+  appendUnsigned(out, num, base);
+  out.appendShort(lineEnding(), lineEndingSize());
+  return out.finish();
 }
 
 size_t Print::println(double num, int digits)
 {
-  size_t n = print(num, digits);
-  n += println();
-  return n;
+  PrintBuffer out(*this);
+  appendFloat(out, num, digits);
+  out.appendShort(lineEnding(), lineEndingSize());
+  return out.finish();
 }
 
 size_t Print::println(const Printable& x)
@@ -207,83 +1042,35 @@ size_t Print::println(const Printable& x)
 }
 
 size_t Print::printf(const char* fmt, ...) {
-  char buf[PRINTF_BUFFER_SIZE];
   va_list args;
   va_start(args, fmt);
-  int status = vsnprintf(buf, PRINTF_BUFFER_SIZE, fmt, args);
+  size_t n = vprintf(fmt, args);
   va_end(args);
-  if (status >= 0) {
-    buf[PRINTF_BUFFER_SIZE - 1] = '\0';
-    size_t n = print(buf);
-    return n;
-  } else {
-    return 0;
-  }
+  return n;
+}
+
+size_t Print::vprintf(const char* fmt, va_list args) {
+  // A copy, which can be passed by reference on all platforms.
+  va_list argsCopy;
+  va_copy(argsCopy, args);
+  PrintBuffer out(*this);
+  appendFormat(out, fmt, argsCopy);
+  va_end(argsCopy);
+  return out.finish();
 }
 
 // Private Methods /////////////////////////////////////////////////////////////
 
-size_t Print::printNumber(unsigned long n, uint8_t base)
+size_t Print::printNumber(unsigned long long n, uint8_t base)
 {
-  char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-  char *str = &buf[sizeof(buf) - 1];
-
-  *str = '\0';
-
-  // prevent crash if called with base == 1
-  if (base < 2) base = 10;
-
-  do {
-    char c = n % base;
-    n /= base;
-
-    *--str = c < 10 ? c + '0' : c + 'A' - 10;
-  } while(n);
-
-  return write(str);
+  PrintBuffer out(*this);
+  appendNumber(out, n, base);
+  return out.finish();
 }
 
 size_t Print::printFloat(double number, uint8_t digits)
 {
-  size_t n = 0;
-
-  if (isnan(number)) return print("nan");
-  if (isinf(number)) return print("inf");
-  if (number > 4294967040.0) return print ("ovf");  // constant determined empirically
-  if (number <-4294967040.0) return print ("ovf");  // constant determined empirically
-
-  // Handle negative numbers
-  if (number < 0.0)
-  {
-     n += print('-');
-     number = -number;
-  }
-
-  // Round correctly so that print(1.999, 2) prints as "2.00"
-  double rounding = 0.5;
-  for (uint8_t i=0; i<digits; ++i)
-    rounding /= 10.0;
-
-  number += rounding;
-
-  // Extract the integer part of the number and print it
-  unsigned long int_part = (unsigned long)number;
-  double remainder = number - (double)int_part;
-  n += print(int_part);
-
-  // Print the decimal point, but only if there are digits beyond
-  if (digits > 0) {
-    n += print('.');
-  }
-
-  // Extract digits from the remainder one at a time
-  while (digits-- > 0)
-  {
-    remainder *= 10.0;
-    unsigned int toPrint = (unsigned int)(remainder);
-    n += print(toPrint);
-    remainder -= toPrint;
-  }
-
-  return n;
+  PrintBuffer out(*this);
+  appendFloat(out, number, digits);
+  return out.finish();
 }
@@ -22,6 +22,7 @@
 #define EPOXY_DUINO_PRINT_H
 
 #include <inttypes.h>
+#include <stdarg.h> // va_list
 #include <string.h> // strlen()
 #include <stddef.h> // size_t
 
@@ -42,9 +43,12 @@ class Print
     int write_error;
     bool isLineModeUnix = false;
 
-    size_t printNumber(unsigned long, uint8_t);
+    size_t printNumber(unsigned long long, uint8_t);
     size_t printFloat(double, uint8_t);
 
+    const char* lineEnding() const { return isLineModeUnix ? "\n" : "\r\n"; }
+    size_t lineEndingSize() const { return isLineModeUnix ? 1 : 2; }
+
   protected:
     void setWriteError(int err = 1) { write_error = err; }
 
@@ -92,6 +96,8 @@ class Print
     size_t print(unsigned int, int = DEC);
     size_t print(long, int = DEC);
     size_t print(unsigned long, int = DEC);
+    size_t print(long long, int = DEC);
+    size_t print(unsigned long long, int = DEC);
     size_t print(double, int = 2);
     size_t print(const Printable&);
 
@@ -104,15 +110,35 @@ class Print
     size_t println(unsigned int, int = DEC);
     size_t println(long, int = DEC);
     size_t println(unsigned long, int = DEC);
+    size_t println(long long, int = DEC);
+    size_t println(unsigned long long, int = DEC);
     size_t println(double, int = 2);
     size_t println(const Printable&);
     size_t println(void);
 
     // printf() extension supported by many microcontrollers including
-    // Teensy, ESP8266 and ESP32 (but not AVR).
-    size_t printf(const char* format, ...);
+    // Teensy, ESP8266 and ESP32 (but not AVR). The output is written to the
+    // sink as it is formatted, without a limit on its length. Returns the
+    // number of bytes written.
+    size_t printf(const char* format, ...)
+        __attribute__((format(printf, 2, 3)));
+
+    // vprintf() version of printf(), also provided by the ESP32.
+    size_t vprintf(const char* format, va_list args);
+
+    /**
+     * Print the arguments using a format string created by EPOXY_FMT(),
+     * which is parsed and checked against the arguments at compile time. See
+     * PrintFormat.h. Returns the number of bytes written. This function is
+     * available only on EpoxyDuino.
+     */
+    template <typename S, typename... Args>
+    size_t format(S formatString, const Args&... args);
 
     virtual void flush() { /* Empty implementation for backward compatibility */ }
 };
 
+#include "PrintBuffer.h"
+#include "PrintFormat.h"
+
 #endif
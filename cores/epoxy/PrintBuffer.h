@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2026 Brian T. Park
+ * MIT License
+ */
+
+/**
+ * @file PrintBuffer.h
+ *
+ * The stack buffer which assembles the output of a print(), println(),
+ * printf() or format() statement, and the conversions which append to it.
+ *
+ * Included by Print.h. Available only on EpoxyDuino.
+ */
+
+#ifndef EPOXY_DUINO_PRINT_BUFFER_H
+#define EPOXY_DUINO_PRINT_BUFFER_H
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint8_t
+#include <string.h> // memcpy(), strlen()
+
+namespace epoxy_print {
+
+/**
+ * Assembles the output of a statement in a small stack buffer, so that it
+ * reaches the sink in a single call to the bulk write(), instead of one
+ * virtual write(uint8_t) per character. Long strings bypass the buffer.
+ */
+class PrintBuffer {
+  public:
+    explicit PrintBuffer(Print& printer) : printer(printer) {}
+
+    void append(char c) {
+      if (len == sizeof(buf)) flush();
+      buf[len++] = c;
+    }
+
+    void append(const char* s, size_t n) {
+      if (n > sizeof(buf) - len) {
+        flush();
+        if (n >= sizeof(buf)) {
+          count += printer.write(s, n);
+          return;
+        }
+      }
+      memcpy(buf + len, s, n);
+      len += n;
+    }
+
+    void append(const char* s) { append(s, strlen(s)); }
+
+    /** Append a few bytes, faster than calling memcpy(). */
+    void appendShort(const char* s, size_t n) {
+      if (n > sizeof(buf) - len) flush();
+      while (n--) buf[len++] = *s++;
+    }
+
+    /** Print `x` to the sink itself, after the pending output. */
+    void appendPrintable(const Printable& x) {
+      flush();
+      count += x.printTo(printer);
+    }
+
+    /** Number of bytes appended so far, including the pending ones. */
+    size_t size() const { return count + len; }
+
+    /** Send the remaining output, and return the number of bytes written. */
+    size_t finish() {
+      flush();
+      return count;
+    }
+
+  private:
+    void flush() {
+      if (len == 0) return;
+      count += printer.write(buf, len);
+      len = 0;
+    }
+
+    Print& printer;
+    char buf[64];
+    size_t len = 0;
+    size_t count = 0;
+};
+
+/** Append the digits of `n` in the given `base`, from 2 to 36. */
+void appendNumber(PrintBuffer& out, unsigned long long n, uint8_t base);
+
+/** Append `number` with `digits` digits after the decimal point. */
+void appendFloat(PrintBuffer& out, double number, uint8_t digits);
+
+} // epoxy_print
+
+#endif
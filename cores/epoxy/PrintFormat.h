@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2026 Brian T. Park
+ * MIT License
+ */
+
+/**
+ * @file PrintFormat.h
+ *
+ * The implementation of `Print::format()`, which prints a format string
+ * checked and split into its pieces at compile time:
+ *
+ * ```C++
+ * Serial.format(EPOXY_FMT("t={} temp={:.1} flags={:X}\n"),
+ *     millis(), temp, flags);
+ * ```
+ *
+ * The format string contains `{}` placeholders, which print the next argument
+ * like `print()` does, and `{{` and `}}` for literal braces. A placeholder can
+ * have a spec:
+ *
+ *  * `{:d}`, `{:X}`, `{:o}`, `{:b}`: an integer in base 10, 16, 8 or 2
+ *  * `{:.N}`: a floating point number with N digits after the decimal point
+ *
+ * The number of arguments, the specs, and the types of the arguments are
+ * checked using `static_assert()`. At runtime, `format()` appends each piece
+ * of literal text and each converted argument to a PrintBuffer on the stack,
+ * without parsing the format string and without varargs. The output reaches
+ * the sink in a single bulk `write()` when it fits the buffer.
+ *
+ * Included by Print.h. Available only on EpoxyDuino.
+ */
+
+#ifndef EPOXY_DUINO_PRINT_FORMAT_H
+#define EPOXY_DUINO_PRINT_FORMAT_H
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint8_t
+#include <type_traits>
+
+/**
+ * Wrap the string literal `s` into a format string for `Print::format()`.
+ * The literal becomes part of a unique type, so that it can be parsed at
+ * compile time.
+ */
+#define EPOXY_FMT(s) \
+  ([] { \
+    struct EpoxyFormatString: epoxy_format::FormatString { \
+      static constexpr const char* data() { return s; } \
+    }; \
+    return EpoxyFormatString(); \
+  }())
+
+namespace epoxy_format {
+
+/** Base class of the format strings created by EPOXY_FMT(). */
+struct FormatString {};
+
+/** Maximum number of characters of literal text appended at a time. */
+static const size_t kMaxLiteral = 256;
+
+/** Kind of the piece of the format string starting at a given position. */
+enum TokenKind {
+  kTokenEnd,
+  kTokenLiteral,
+  kTokenEscape, // "{{" or "}}"
+  kTokenPlaceholder,
+  kTokenError,
+};
+
+constexpr bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+/** Position of the '}' which closes the placeholder at `i`, or of the NUL. */
+constexpr size_t closingBrace(const char* s, size_t i) {
+  return (s[i] == '\0' || s[i] == '}') ? i : closingBrace(s, i + 1);
+}
+
+/** Return true if `s` from `i` to `end` are all digits. */
+constexpr bool allDigits(const char* s, size_t i, size_t end) {
+  return i == end || (isDigit(s[i]) && allDigits(s, i + 1, end));
+}
+
+/** Value of the digits of `s` from `i` to `end`. */
+constexpr int parseDigits(const char* s, size_t i, size_t end, int value) {
+  return i == end ? value : parseDigits(s, i + 1, end, value * 10 + s[i] - '0');
+}
+
+/** Base of the spec "{:d}", "{:X}", "{:o}" or "{:b}" at `i`, otherwise 0. */
+constexpr int specBase(const char* s, size_t i) {
+  return (s[i + 1] != ':' || closingBrace(s, i) != i + 3) ? 0
+      : s[i + 2] == 'd' ? 10
+      : s[i + 2] == 'X' ? 16
+      : s[i + 2] == 'o' ? 8
+      : s[i + 2] == 'b' ? 2
+      : 0;
+}
+
+/** Digits of the spec "{:.N}" at `i`, otherwise -1. */
+constexpr int specDigits(const char* s, size_t i) {
+  return (s[i + 1] == ':' && s[i + 2] == '.'
+      && closingBrace(s, i) > i + 3
+      && allDigits(s, i + 3, closingBrace(s, i)))
+    ? parseDigits(s, i + 3, closingBrace(s, i), 0)
+    : -1;
+}
+
+/** Return true if the placeholder at `i` is terminated and has a valid spec. */
+constexpr bool isValidPlaceholder(const char* s, size_t i) {
+  return s[closingBrace(s, i)] == '}'
+      && (closingBrace(s, i) == i + 1
+          || specBase(s, i) != 0
+          || (specDigits(s, i) >= 0 && specDigits(s, i) <= 255));
+}
+
+constexpr TokenKind tokenKind(const char* s, size_t i) {
+  return s[i] == '\0' ? kTokenEnd
+      : s[i] == '{' ? (s[i + 1] == '{' ? kTokenEscape
+          : isValidPlaceholder(s, i) ? kTokenPlaceholder : kTokenError)
+      : s[i] == '}' ? (s[i + 1] == '}' ? kTokenEscape : kTokenError)
+      : kTokenLiteral;
+}
+
+/**
+ * End of the literal text starting at `i`, limited to `kMaxLiteral`
+ * characters to bound the depth of the constexpr recursion.
+ */
+constexpr size_t literalEnd(const char* s, size_t i, size_t limit) {
+  return (limit == 0 || s[i] == '\0' || s[i] == '{' || s[i] == '}') ? i
+      : literalEnd(s, i + 1, limit - 1);
+}
+
+/** Kind of a format argument, which selects how it is printed. */
+enum ArgKind {
+  kArgChar,
+  kArgInteger,
+  kArgFloat,
+  kArgCString,
+  kArgString,
+  kArgFlashString,
+  kArgPrintable,
+  kArgUnsupported,
+};
+
+template <typename T>
+struct ArgKindOf {
+  static const ArgKind value =
+      std::is_same<T, char>::value ? kArgChar
+      : std::is_integral<T>::value ? kArgInteger
+      : std::is_floating_point<T>::value ? kArgFloat
+      : std::is_convertible<const T&, const char*>::value ? kArgCString
+      : std::is_same<T, String>::value ? kArgString
+      : std::is_convertible<const T&, const __FlashStringHelper*>::value
+          ? kArgFlashString
+      : std::is_base_of<Printable, T>::value ? kArgPrintable
+      : kArgUnsupported;
+};
+
+template <ArgKind K>
+using ArgTag = std::integral_constant<ArgKind, K>;
+
+/** Appends a single argument, with the base or digits of its spec. */
+struct Writer {
+  typedef epoxy_print::PrintBuffer PrintBuffer;
+
+  template <int Base, int Digits, typename T>
+  static void write(PrintBuffer& out, const T& arg) {
+    write<Base, Digits>(out, arg, ArgTag<ArgKindOf<T>::value>());
+  }
+
+  template <int Base, int Digits, typename T>
+  static void write(PrintBuffer& out, const T& arg, ArgTag<kArgInteger>) {
+    static_assert(Digits < 0, "{:.N} requires a floating point argument");
+    const uint8_t base = (Base == 0) ? 10 : Base;
+    unsigned long long n = (unsigned long long) arg;
+    if (isNegative(arg, std::is_signed<T>())) {
+      // Like print(long long): a sign in base 10, otherwise the two's
+      // complement of a long long.
+      n = (unsigned long long) (long long) arg;
+      if (base == 10) {
+        out.append('-');
+        n = 0 - n;
+      }
+    }
+    epoxy_print::appendNumber(out, n, base);
+  }
+
+  template <int Base, int Digits>
+  static void write(PrintBuffer& out, double arg, ArgTag<kArgFloat>) {
+    static_assert(Base == 0, "{:d}, {:X}, {:o}, {:b} require an integer");
+    epoxy_print::appendFloat(out, arg, (Digits < 0) ? 2 : Digits);
+  }
+
+  template <int Base, int Digits>
+  static void write(PrintBuffer& out, char arg, ArgTag<kArgChar>) {
+    static_assert(Base == 0 && Digits < 0, "a char takes no spec");
+    out.append(arg);
+  }
+
+  template <int Base, int Digits>
+  static void write(PrintBuffer& out, const char* arg, ArgTag<kArgCString>) {
+    static_assert(Base == 0 && Digits < 0, "a string takes no spec");
+    if (arg != nullptr) out.append(arg);
+  }
+
+  template <int Base, int Digits>
+  static void write(PrintBuffer& out, const String& arg, ArgTag<kArgString>) {
+    static_assert(Base == 0 && Digits < 0, "a String takes no spec");
+    out.append(arg.c_str(), arg.length());
+  }
+
+  template <int Base, int Digits>
+  static void write(PrintBuffer& out, const __FlashStringHelper* arg,
+      ArgTag<kArgFlashString>) {
+    static_assert(Base == 0 && Digits < 0, "a F() string takes no spec");
+    // Flash memory is ordinary memory on EpoxyDuino.
+    out.append(reinterpret_cast<const char*>(arg));
+  }
+
+  template <int Base, int Digits>
+  static void write(PrintBuffer& out, const Printable& arg,
+      ArgTag<kArgPrintable>) {
+    static_assert(Base == 0 && Digits < 0, "a Printable takes no spec");
+    out.appendPrintable(arg);
+  }
+
+  template <int Base, int Digits, typename T>
+  static void write(PrintBuffer&, const T&, ArgTag<kArgUnsupported>) {
+    static_assert(sizeof(T) == 0, "unsupported argument type for format()");
+  }
+
+  // Avoids the warning about comparing an unsigned number with 0.
+  template <typename T>
+  static bool isNegative(const T& arg, std::true_type) { return arg < 0; }
+
+  template <typename T>
+  static bool isNegative(const T&, std::false_type) { return false; }
+};
+
+/**
+ * Appends the piece of the format string of `S` starting at `Pos`, then the
+ * rest of the format string by recursion.
+ */
+template <typename S, size_t Pos, TokenKind Kind = tokenKind(S::data(), Pos)>
+struct Emitter;
+
+template <typename S, size_t Pos>
+struct Emitter<S, Pos, kTokenEnd> {
+  template <typename... Args>
+  static void emit(epoxy_print::PrintBuffer&, const Args&...) {
+    static_assert(sizeof...(Args) == 0,
+        "too many arguments for the format string");
+  }
+};
+
+template <typename S, size_t Pos>
+struct Emitter<S, Pos, kTokenLiteral> {
+  static constexpr size_t kEnd = literalEnd(S::data(), Pos, kMaxLiteral);
+
+  template <typename... Args>
+  static void emit(epoxy_print::PrintBuffer& out, const Args&... args) {
+    out.append(S::data() + Pos, kEnd - Pos);
+    Emitter<S, kEnd>::emit(out, args...);
+  }
+};
+
+template <typename S, size_t Pos>
+struct Emitter<S, Pos, kTokenEscape> {
+  template <typename... Args>
+  static void emit(epoxy_print::PrintBuffer& out, const Args&... args) {
+    out.append(S::data()[Pos]);
+    Emitter<S, Pos + 2>::emit(out, args...);
+  }
+};
+
+template <typename S, size_t Pos>
+struct Emitter<S, Pos, kTokenPlaceholder> {
+  static constexpr size_t kEnd = closingBrace(S::data(), Pos) + 1;
+  static constexpr int kBase = specBase(S::data(), Pos);
+  static constexpr int kDigits = specDigits(S::data(), Pos);
+
+  template <typename T, typename... Rest>
+  static void emit(epoxy_print::PrintBuffer& out, const T& arg,
+      const Rest&... rest) {
+    Writer::write<kBase, kDigits>(out, arg);
+    Emitter<S, kEnd>::emit(out, rest...);
+  }
+
+  static void emit(epoxy_print::PrintBuffer&) {
+    static_assert(Pos != Pos, "too few arguments for the format string");
+  }
+};
+
+template <typename S, size_t Pos>
+struct Emitter<S, Pos, kTokenError> {
+  template <typename... Args>
+  static void emit(epoxy_print::PrintBuffer&, const Args&...) {
+    static_assert(Pos != Pos,
+        "invalid format string: unmatched brace or invalid spec");
+  }
+};
+
+} // epoxy_format
+
+template <typename S, typename... Args>
+size_t Print::format(S, const Args&... args) {
+  static_assert(std::is_base_of<epoxy_format::FormatString, S>::value,
+      "the format string must be created with EPOXY_FMT()");
+  epoxy_print::PrintBuffer out(*this);
+  epoxy_format::Emitter<S, 0>::emit(out, args...);
+  return out.finish();
+}
+
+#endif
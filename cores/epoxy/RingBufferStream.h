@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2026 Brian T. Park
+ * MIT License
+ */
+
+#ifndef EPOXY_DUINO_RING_BUFFER_STREAM_H
+#define EPOXY_DUINO_RING_BUFFER_STREAM_H
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint8_t
+#include <string.h> // memcpy()
+#include "Print.h"
+#include "Stream.h"
+
+/**
+ * A Stream backed by a ring buffer of fixed capacity `N`, like the RX and TX
+ * buffers of a UART. Writing to a full buffer drops the data which does not
+ * fit, and `availableForWrite()` returns the free space. The unread contents
+ * can be inspected in place with `peekBuffer()`, which returns the
+ * contiguous part of the contents starting at the read position.
+ *
+ * Reading never waits, since no more data can arrive while the caller waits:
+ * the timeout of the Stream starts at 0 instead of 1000 milliseconds, so
+ * `readString()`, `parseInt()` and `find()` also return as soon as the
+ * contents run out. This class is available only on EpoxyDuino.
+ */
+template <size_t N>
+class RingBufferStream: public Stream {
+  public:
+    RingBufferStream() { setTimeout(0); }
+
+    size_t write(uint8_t c) override {
+      if (count == N) return 0;
+      buffer[(head + count) % N] = c;
+      count++;
+      return 1;
+    }
+
+    size_t write(const uint8_t* src, size_t size) override {
+      if (size > N - count) size = N - count;
+      size_t tail = (head + count) % N;
+      size_t first = N - tail;
+      if (first > size) first = size;
+      memcpy(buffer + tail, src, first);
+      memcpy(buffer, src + first, size - first);
+      count += size;
+      return size;
+    }
+
+    using Print::write;
+
+    int availableForWrite() override { return N - count; }
+
+    int available() override { return count; }
+
+    int read() override {
+      if (count == 0) return -1;
+      uint8_t c = buffer[head];
+      peekConsume(1);
+      return c;
+    }
+
+    int peek() override {
+      if (count == 0) return -1;
+      return buffer[head];
+    }
+
+    /** Copy the unread contents in bulk. */
+    int read(uint8_t* dest, size_t length) override {
+      size_t size = (length < count) ? length : count;
+      size_t first = N - head;
+      if (first > size) first = size;
+      memcpy(dest, buffer + head, first);
+      memcpy(dest + first, buffer, size - first);
+      peekConsume(size);
+      return size;
+    }
+
+    using Stream::read;
+
+    /** Same as `read(dest, length)`. Returns immediately. */
+    size_t readBytes(char* dest, size_t length) override {
+      return read((uint8_t*) dest, length);
+    }
+
+    using Stream::readBytes;
+
+    /** Number of unread bytes. */
+    size_t size() const { return count; }
+
+    /** Total capacity of the buffer. */
+    static constexpr size_t capacity() { return N; }
+
+    /** Discard the contents. */
+    void clear() { head = count = 0; }
+
+    bool hasPeekBufferAPI() const override { return true; }
+
+    /**
+     * Number of unread bytes which are contiguous in the buffer, returned by
+     * `peekBuffer()`. Less than `available()` if the contents wrap around.
+     */
+    size_t peekAvailable() override {
+      return (head + count <= N) ? count : N - head;
+    }
+
+    /** Pointer to the first `peekAvailable()` unread bytes. */
+    const char* peekBuffer() override { return (const char*) buffer + head; }
+
+    /** Discard `size` bytes which were inspected using `peekBuffer()`. */
+    void peekConsume(size_t size) override {
+      if (size > count) size = count;
+      count -= size;
+      // Restart at the front when empty, to keep the contents contiguous.
+      head = (count == 0) ? 0 : (head + size) % N;
+    }
+
+  private:
+    uint8_t buffer[N];
+    size_t head = 0;
+    size_t count = 0;
+};
+
+#endif
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2026 Brian T. Park
+ * MIT License
+ */
+
+#include <string.h> // memcpy(), memcmp()
+#include "Arduino.h" // micros()
+#include "SerialTrace.h"
+
+static const char kTraceHeader[] = "EPXT\x01";
+static const size_t kTraceHeaderSize = sizeof(kTraceHeader) - 1;
+
+//-----------------------------------------------------------------------------
+// SerialTraceWriter
+//-----------------------------------------------------------------------------
+
+bool SerialTraceWriter::open(const char* path) {
+  close();
+  file = fopen(path, "wb");
+  if (file == nullptr) {
+    perror("SerialTraceWriter::open(): fopen() failure");
+    return false;
+  }
+  fwrite(kTraceHeader, 1, kTraceHeaderSize, file);
+  lastMicros = micros();
+  chunkSize = 0;
+  return true;
+}
+
+void SerialTraceWriter::close() {
+  if (file == nullptr) return;
+  writeChunk();
+  fclose(file);
+  file = nullptr;
+}
+
+void SerialTraceWriter::record(EpoxyTraceDirection direction,
+    const uint8_t* data, size_t size) {
+  if (file == nullptr) return;
+
+  unsigned long now = micros();
+  if (chunkSize > 0 && (direction != chunkDirection
+      || now - chunkMicros > EPOXY_SERIAL_TRACE_COALESCE_MICROS)) {
+    writeChunk();
+  }
+
+  while (size > 0) {
+    if (chunkSize == 0) {
+      chunkDirection = direction;
+      chunkMicros = now;
+    }
+    size_t n = EPOXY_SERIAL_TRACE_CHUNK_SIZE - chunkSize;
+    if (n > size) n = size;
+    memcpy(chunk + chunkSize, data, n);
+    chunkSize += n;
+    data += n;
+    size -= n;
+    if (chunkSize == EPOXY_SERIAL_TRACE_CHUNK_SIZE) writeChunk();
+  }
+}
+
+void SerialTraceWriter::writeChunk() {
+  if (chunkSize == 0) return;
+
+  fputc(chunkDirection, file);
+  writeVarint(chunkMicros - lastMicros);
+  writeVarint(chunkSize);
+  fwrite(chunk, 1, chunkSize, file);
+  lastMicros = chunkMicros;
+  chunkSize = 0;
+}
+
+void SerialTraceWriter::writeVarint(unsigned long value) {
+  while (value >= 0x80) {
+    fputc((value & 0x7F) | 0x80, file);
+    value >>= 7;
+  }
+  fputc(value, file);
+}
+
+//-----------------------------------------------------------------------------
+// SerialTraceReader
+//-----------------------------------------------------------------------------
+
+bool SerialTraceReader::open(const char* path, bool isRealtime) {
+  close();
+  file = fopen(path, "rb");
+  if (file == nullptr) {
+    perror("SerialTraceReader::open(): fopen() failure");
+    return false;
+  }
+
+  char header[kTraceHeaderSize];
+  if (fread(header, 1, kTraceHeaderSize, file) != kTraceHeaderSize
+      || memcmp(header, kTraceHeader, kTraceHeaderSize) != 0) {
+    fprintf(stderr, "SerialTraceReader::open(): Not a trace file '%s'\n",
+        path);
+    close();
+    return false;
+  }
+
+  realtime = isRealtime;
+  eof = false;
+  dueMicros = micros();
+  remaining = 0;
+  return true;
+}
+
+void SerialTraceReader::close() {
+  if (file == nullptr) return;
+  fclose(file);
+  file = nullptr;
+  eof = true;
+}
+
+bool SerialTraceReader::nextRecord() {
+  while (true) {
+    int direction = fgetc(file);
+    unsigned long delta;
+    unsigned long length;
+    if (direction == EOF || ! readVarint(&delta) || ! readVarint(&length)) {
+      return false;
+    }
+
+    // The time of the TX records counts too, since they occurred between
+    // the RX records.
+    dueMicros += delta;
+    if (direction == EPOXY_TRACE_RX && length > 0) {
+      remaining = length;
+      return true;
+    }
+    if (fseek(file, length, SEEK_CUR) != 0) return false;
+  }
+}
+
+bool SerialTraceReader::readVarint(unsigned long* value) {
+  *value = 0;
+  for (unsigned shift = 0; shift < 8 * sizeof(*value); shift += 7) {
+    int c = fgetc(file);
+    if (c == EOF) return false;
+    *value |= (unsigned long) (c & 0x7F) << shift;
+    if ((c & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+size_t SerialTraceReader::read(uint8_t* buffer, size_t size,
+    unsigned long* waitMicros) {
+  *waitMicros = 0;
+  if (eof) return 0;
+  if (remaining == 0 && ! nextRecord()) {
+    eof = true;
+    return 0;
+  }
+
+  if (realtime) {
+    long early = (long) (dueMicros - micros());
+    if (early > 0) {
+      *waitMicros = early;
+      return 0;
+    }
+  }
+
+  size_t n = (size < remaining) ? size : remaining;
+  n = fread(buffer, 1, n, file);
+  if (n == 0) {
+    // Truncated file.
+    eof = true;
+    return 0;
+  }
+  remaining -= n;
+  return n;
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2026 Brian T. Park
+ * MIT License
+ */
+
+#ifndef EPOXY_DUINO_SERIAL_TRACE_H
+#define EPOXY_DUINO_SERIAL_TRACE_H
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint8_t
+#include <stdio.h> // FILE
+
+/**
+ * Consecutive bytes in the same direction are coalesced into one record as
+ * long as they occur within this many microseconds of the first byte.
+ */
+#ifndef EPOXY_SERIAL_TRACE_COALESCE_MICROS
+  #define EPOXY_SERIAL_TRACE_COALESCE_MICROS 1000
+#endif
+
+/** Maximum size of the payload of a record. */
+#ifndef EPOXY_SERIAL_TRACE_CHUNK_SIZE
+  #define EPOXY_SERIAL_TRACE_CHUNK_SIZE 4096
+#endif
+
+/** Direction of the data in a trace record. */
+enum EpoxyTraceDirection {
+  /** Received by the sketch. */
+  EPOXY_TRACE_RX = 0,
+
+  /** Sent by the sketch. */
+  EPOXY_TRACE_TX = 1,
+};
+
+/**
+ * Writes a binary trace of the traffic of a serial port. The file starts with
+ * the 5 bytes `EPXT\x01`, followed by records of:
+ *
+ *  * direction (1 byte, EpoxyTraceDirection)
+ *  * microseconds since the previous record, or since the start of the trace
+ *    for the first record (unsigned LEB128 varint)
+ *  * length of the payload (unsigned LEB128 varint)
+ *  * payload
+ *
+ * Used internally by FdSerial. Available only on EpoxyDuino.
+ */
+class SerialTraceWriter {
+  public:
+    SerialTraceWriter() {}
+
+    ~SerialTraceWriter() { close(); }
+
+    /** Create the trace file. Returns false if it cannot be created. */
+    bool open(const char* path);
+
+    /** Write the pending record and close the file. */
+    void close();
+
+    /** Record `size` bytes of `data` in the given direction. */
+    void record(EpoxyTraceDirection direction, const uint8_t* data,
+        size_t size);
+
+  private:
+    /** Write the pending chunk as a record. */
+    void writeChunk();
+
+    void writeVarint(unsigned long value);
+
+    FILE* file = nullptr;
+    unsigned long lastMicros = 0;
+    unsigned long chunkMicros = 0;
+    EpoxyTraceDirection chunkDirection = EPOXY_TRACE_RX;
+    size_t chunkSize = 0;
+    uint8_t chunk[EPOXY_SERIAL_TRACE_CHUNK_SIZE];
+};
+
+/**
+ * Reads the RX records of a trace written by SerialTraceWriter, and returns
+ * their payload at the time relative to `open()` when it was recorded, or as
+ * fast as possible. The TX records are skipped.
+ *
+ * Used internally by FdSerial. Available only on EpoxyDuino.
+ */
+class SerialTraceReader {
+  public:
+    SerialTraceReader() {}
+
+    ~SerialTraceReader() { close(); }
+
+    /**
+     * Open the trace file. If `realtime` is true, the data is returned at its
+     * original timing, otherwise immediately. Returns false and prints the
+     * reason on STDERR if the file cannot be read.
+     */
+    bool open(const char* path, bool realtime);
+
+    void close();
+
+    /**
+     * Copy up to `size` bytes of the input which is due now into `buffer`,
+     * and return the number of bytes copied. If nothing is due, returns 0 and
+     * sets `waitMicros` to the time until the next record.
+     */
+    size_t read(uint8_t* buffer, size_t size, unsigned long* waitMicros);
+
+    /** Return true when all the records have been read. */
+    bool isEof() const { return eof; }
+
+  private:
+    /** Move to the next RX record. Returns false at the end of the file. */
+    bool nextRecord();
+
+    bool readVarint(unsigned long* value);
+
+    FILE* file = nullptr;
+    bool realtime = true;
+    bool eof = false;
+    unsigned long dueMicros = 0;
+    size_t remaining = 0;
+};
+
+#endif
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2026 Brian T. Park
+ * MIT License
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h> // memcpy()
+#include <sys/uio.h> // writev()
+#include "SerialWriterThread.h"
+
+SerialWriterThread::SerialWriterThread(int fd, EpoxyWriterPolicy policy) :
+    fd(fd),
+    policy(policy),
+    head(0),
+    tail(0),
+    dropped(0),
+    writerSleeping(false),
+    producerWaiting(false),
+    stopping(false) {
+  pthread_mutex_init(&mutex, nullptr);
+  pthread_cond_init(&dataCond, nullptr);
+  pthread_cond_init(&spaceCond, nullptr);
+}
+
+SerialWriterThread::~SerialWriterThread() {
+  stop();
+  pthread_cond_destroy(&spaceCond);
+  pthread_cond_destroy(&dataCond);
+  pthread_mutex_destroy(&mutex);
+}
+
+bool SerialWriterThread::start() {
+  running = pthread_create(&thread, nullptr, run, this) == 0;
+  return running;
+}
+
+void SerialWriterThread::stop() {
+  if (! running) return;
+
+  pthread_mutex_lock(&mutex);
+  stopping = true;
+  pthread_cond_signal(&dataCond);
+  pthread_mutex_unlock(&mutex);
+  pthread_join(thread, nullptr);
+  running = false;
+}
+
+//-----------------------------------------------------------------------------
+// Producer side, called by loop().
+//-----------------------------------------------------------------------------
+
+size_t SerialWriterThread::available() const {
+  return EPOXY_SERIAL_WRITER_QUEUE_SIZE - (tail.load() - head.load());
+}
+
+size_t SerialWriterThread::push(const uint8_t* data, size_t size) {
+  uint64_t t = tail.load(std::memory_order_relaxed);
+  size_t accepted = size;
+
+  switch (policy) {
+    case EPOXY_WRITER_DROP_NEWEST: {
+      size_t space = available();
+      if (size > space) {
+        dropped += size - space;
+        size = space;
+        accepted = space;
+      }
+      break;
+    }
+
+    case EPOXY_WRITER_DROP_OLDEST: {
+      // Only the last part of a large write fits.
+      if (size > EPOXY_SERIAL_WRITER_QUEUE_SIZE) {
+        dropped += size - EPOXY_SERIAL_WRITER_QUEUE_SIZE;
+        data += size - EPOXY_SERIAL_WRITER_QUEUE_SIZE;
+        size = EPOXY_SERIAL_WRITER_QUEUE_SIZE;
+      }
+      uint64_t h = head.load();
+      while (t + size - h > EPOXY_SERIAL_WRITER_QUEUE_SIZE) {
+        uint64_t newHead = t + size - EPOXY_SERIAL_WRITER_QUEUE_SIZE;
+        // On failure, 'h' is reloaded with the position of the writer.
+        if (head.compare_exchange_weak(h, newHead)) {
+          dropped += newHead - h;
+          break;
+        }
+      }
+      break;
+    }
+
+    default: {
+      // Block: push what fits, then wait for the writer to make space.
+      while (size > 0) {
+        size_t space = available();
+        if (space == 0) {
+          pthread_mutex_lock(&mutex);
+          producerWaiting = true;
+          while (available() == 0) pthread_cond_wait(&spaceCond, &mutex);
+          producerWaiting = false;
+          pthread_mutex_unlock(&mutex);
+          continue;
+        }
+        size_t n = (size < space) ? size : space;
+        copyIn(t, data, n);
+        t += n;
+        tail.store(t);
+        notifyWriter();
+        data += n;
+        size -= n;
+      }
+      return accepted;
+    }
+  }
+
+  if (size > 0) {
+    copyIn(t, data, size);
+    tail.store(t + size);
+    notifyWriter();
+  }
+  return accepted;
+}
+
+void SerialWriterThread::drain() {
+  pthread_mutex_lock(&mutex);
+  producerWaiting = true;
+  while (head.load() != tail.load()) {
+    pthread_cond_wait(&spaceCond, &mutex);
+  }
+  producerWaiting = false;
+  pthread_mutex_unlock(&mutex);
+}
+
+void SerialWriterThread::notifyWriter() {
+  // Both sides use sequentially consistent atomics, so either the writer sees
+  // the new tail before it sleeps, or this sees that it is sleeping.
+  if (writerSleeping.load()) {
+    pthread_mutex_lock(&mutex);
+    pthread_cond_signal(&dataCond);
+    pthread_mutex_unlock(&mutex);
+  }
+}
+
+void SerialWriterThread::copyIn(uint64_t position, const uint8_t* src,
+    size_t size) {
+  size_t index = position & kMask;
+  size_t first = EPOXY_SERIAL_WRITER_QUEUE_SIZE - index;
+  if (first > size) first = size;
+  memcpy(queue + index, src, first);
+  memcpy(queue, src + first, size - first);
+}
+
+//-----------------------------------------------------------------------------
+// Writer thread.
+//-----------------------------------------------------------------------------
+
+void* SerialWriterThread::run(void* arg) {
+  static_cast<SerialWriterThread*>(arg)->writeLoop();
+  return nullptr;
+}
+
+void SerialWriterThread::writeLoop() {
+  while (true) {
+    uint64_t h = head.load();
+    uint64_t t = tail.load();
+    if (h == t) {
+      if (stopping) break;
+
+      pthread_mutex_lock(&mutex);
+      writerSleeping = true;
+      while (head.load() == tail.load() && ! stopping) {
+        pthread_cond_wait(&dataCond, &mutex);
+      }
+      writerSleeping = false;
+      pthread_mutex_unlock(&mutex);
+      continue;
+    }
+
+    size_t size = t - h;
+    if (policy == EPOXY_WRITER_DROP_OLDEST) {
+      if (size > kCopySize) size = kCopySize;
+      copyOut(h, copy, size);
+      // The producer dropped some of the copied bytes, so try again.
+      if (! head.compare_exchange_strong(h, h + size)) continue;
+
+      struct iovec iov[1] = {{copy, size}};
+      writeFully(iov, 1);
+    } else {
+      // The producer never touches [head, tail), so send it in place, in 2
+      // pieces if it wraps around.
+      size_t index = h & kMask;
+      size_t first = EPOXY_SERIAL_WRITER_QUEUE_SIZE - index;
+      if (first > size) first = size;
+      struct iovec iov[2] = {
+        {queue + index, first},
+        {queue, size - first},
+      };
+      writeFully(iov, (size > first) ? 2 : 1);
+      head.store(h + size);
+    }
+
+    notifyProducer();
+  }
+  notifyProducer();
+}
+
+void SerialWriterThread::notifyProducer() {
+  if (producerWaiting.load()) {
+    pthread_mutex_lock(&mutex);
+    pthread_cond_broadcast(&spaceCond);
+    pthread_mutex_unlock(&mutex);
+  }
+}
+
+void SerialWriterThread::copyOut(uint64_t position, uint8_t* dest,
+    size_t size) const {
+  size_t index = position & kMask;
+  size_t first = EPOXY_SERIAL_WRITER_QUEUE_SIZE - index;
+  if (first > size) first = size;
+  memcpy(dest, queue + index, first);
+  memcpy(dest + first, queue, size - first);
+}
+
+void SerialWriterThread::writeFully(struct iovec* iov, int iovcnt) {
+  while (iovcnt > 0) {
+    ssize_t status = writev(fd, iov, iovcnt);
+    if (status < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN) {
+        // STDOUT shares the O_NONBLOCK flag of STDIN if both are the terminal.
+        struct pollfd pfd = {fd, POLLOUT, 0};
+        poll(&pfd, 1, -1);
+        continue;
+      }
+      // The output cannot be sent (e.g. closed STDOUT), so discard it.
+      return;
+    }
+
+    // Skip the pieces which were sent completely.
+    size_t sent = status;
+    while (iovcnt > 0 && sent >= iov->iov_len) {
+      sent -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = (uint8_t*) iov->iov_base + sent;
+      iov->iov_len -= sent;
+    }
+  }
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2026 Brian T. Park
+ * MIT License
+ */
+
+#ifndef EPOXY_DUINO_SERIAL_WRITER_THREAD_H
+#define EPOXY_DUINO_SERIAL_WRITER_THREAD_H
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint8_t, uint64_t
+#include <pthread.h>
+#include <atomic>
+#include "FdSerial.h" // EpoxyWriterPolicy, EPOXY_SERIAL_WRITER_QUEUE_SIZE
+
+/**
+ * A thread which sends the output of a serial port to its file descriptor, so
+ * that `loop()` never blocks on a slow consumer of the output. The data goes
+ * through a lock-free single-producer single-consumer ring buffer. The mutex
+ * and condition variables are used only to sleep when the queue is empty (the
+ * writer) or full (`loop()`), never to access the data.
+ *
+ * With the EPOXY_WRITER_DROP_OLDEST policy, the producer may move the head of
+ * the queue to make room. So the writer copies the data out of the queue, then
+ * commits its read with a compare-and-swap, and discards the copy if the
+ * producer overwrote it in the meantime.
+ *
+ * Used internally by FdSerial. Available only on EpoxyDuino.
+ */
+class SerialWriterThread {
+  public:
+    SerialWriterThread(int fd, EpoxyWriterPolicy policy);
+
+    ~SerialWriterThread();
+
+    /** Start the thread. Returns false if it cannot be created. */
+    bool start();
+
+    /** Send the remaining data, then terminate the thread. */
+    void stop();
+
+    /**
+     * Add `size` bytes to the queue, waiting or dropping data according to
+     * the policy if the queue is full. Returns the number of bytes of `data`
+     * which were accepted.
+     */
+    size_t push(const uint8_t* data, size_t size);
+
+    /** Wait until the writer has sent everything in the queue. */
+    void drain();
+
+    /** Free space in the queue. */
+    size_t available() const;
+
+    /** Number of bytes dropped because the queue was full. */
+    uint64_t getDroppedCount() const { return dropped.load(); }
+
+  private:
+    static const uint64_t kMask = EPOXY_SERIAL_WRITER_QUEUE_SIZE - 1;
+    static const size_t kCopySize = 16384;
+
+    static void* run(void* arg);
+
+    /** Main loop of the writer thread. */
+    void writeLoop();
+
+    /** Copy `size` bytes at `position` of the queue into `dest`. */
+    void copyOut(uint64_t position, uint8_t* dest, size_t size) const;
+
+    /** Copy `size` bytes from `src` into the queue at `position`. */
+    void copyIn(uint64_t position, const uint8_t* src, size_t size);
+
+    /** Send all of `iov`, waiting for the fd if it is non-blocking. */
+    void writeFully(struct iovec* iov, int iovcnt);
+
+    /** Wake up the writer if it sleeps on an empty queue. */
+    void notifyWriter();
+
+    /** Wake up loop() if it waits for space, or for drain(). */
+    void notifyProducer();
+
+    int const fd;
+    EpoxyWriterPolicy const policy;
+
+    uint8_t queue[EPOXY_SERIAL_WRITER_QUEUE_SIZE];
+    // Monotonic positions. The writer owns 'head' (except for the
+    // EPOXY_WRITER_DROP_OLDEST policy), and the producer owns 'tail'.
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    std::atomic<uint64_t> dropped;
+
+    std::atomic<bool> writerSleeping;
+    std::atomic<bool> producerWaiting;
+    std::atomic<bool> stopping;
+    pthread_mutex_t mutex;
+    pthread_cond_t dataCond;
+    pthread_cond_t spaceCond;
+    pthread_t thread;
+    bool running = false;
+
+    // Used only by the writer thread for EPOXY_WRITER_DROP_OLDEST.
+    uint8_t copy[kCopySize];
+};
+
+#endif
@@ -6,38 +6,27 @@
 #ifndef EPOXY_DUINO_STDIO_SERIAL_H
 #define EPOXY_DUINO_STDIO_SERIAL_H
 
-#include "Print.h"
-#include "Stream.h"
+#include "FdSerial.h"
 
 /**
  * A version of Serial that reads from STDIN and sends output to STDOUT on
  * Linux or MacOS.
+ *
+ * The output is buffered (see FdSerial), and is also sent at exit. Unlike the
+ * other ports, writing to a full buffer waits for STDOUT instead of dropping
+ * the data. If STDOUT is a terminal, the output is sent at the end of each
+ * line, like the line buffering of `<stdio.h>`.
  */
-class StdioSerial: public Stream {
+class StdioSerial: public FdSerial {
   public:
-    void begin(unsigned long /*baud*/) { bufch = -1; }
-
-    size_t write(uint8_t c) override;
-
-    // Pull in all other overloaded versions of the write() function from the
-    // Print parent class. This is required because when we override one version
-    // of write() above, C++ performs a static binding to the write() function
-    // in the current class and doesn't bother searching the parent classes for
-    // any other overloaded function that it could bind to. (30 years of C++ and
-    // I still get shot with C++ footguns like this. I have no idea what happens
-    // if the Stream class overloaded the write() function.)
-    using Print::write;
-
-    operator bool() { return true; }
-
-    int available() override;
-
-    int read() override;
-
-    int peek() override;
+    /**
+     * Register STDIN and STDOUT with the scheduler so that yield() wakes up as
+     * soon as a character arrives, instead of after a fixed sleep.
+     */
+    StdioSerial();
 
   private:
-    int bufch;
+    static void flushAtExit();
 };
 
 extern StdioSerial Serial;
@@ -23,20 +23,40 @@
  findMulti/findUntil routines written by Jim Leonard/Xuth
  */
 
+#include <stdint.h> // UINT32_MAX
+#include <stdlib.h> // malloc(), free()
+#include <string.h> // memchr(), memcpy(), memset()
 #include "Arduino.h"
 #include "Stream.h"
 
 #define PARSE_TIMEOUT 1000  // default number of milli-seconds to wait
 
+// default bulk read, one byte at a time without waiting
+int Stream::read(uint8_t *buffer, size_t length)
+{
+  size_t count = 0;
+  while (count < length) {
+    int c = read();
+    if (c < 0) break;
+    buffer[count++] = (uint8_t)c;
+  }
+  return count;
+}
+
 // protected method to read stream with timeout
+// Calls waitForInput() while waiting, which keeps the CPU idle and lets the
+// virtual clock advance toward the timeout.
 int Stream::timedRead()
 {
   int c;
   _startMillis = millis();
-  do {
+  while (true) {
     c = read();
     if (c >= 0) return c;
-  } while(millis() - _startMillis < _timeout);
+    unsigned long elapsed = millis() - _startMillis;
+    if (elapsed >= _timeout) break;
+    waitForInput(_timeout - elapsed);
+  }
   return -1;     // -1 indicates timeout
 }
 
@@ -45,13 +65,22 @@ int Stream::timedPeek()
 {
   int c;
   _startMillis = millis();
-  do {
+  while (true) {
     c = peek();
     if (c >= 0) return c;
-  } while(millis() - _startMillis < _timeout);
+    unsigned long elapsed = millis() - _startMillis;
+    if (elapsed >= _timeout) break;
+    waitForInput(_timeout - elapsed);
+  }
   return -1;     // -1 indicates timeout
 }
 
+// Like the ESP8266 core, yield() while waiting.
+void Stream::waitForInput(unsigned long /*maxMillis*/)
+{
+  yield();
+}
+
 // returns peek of the next digit in the stream or -1 if timeout
 // discards non-numeric characters
 int Stream::peekNextDigit(LookaheadMode lookahead, bool detectDecimal)
@@ -204,10 +233,15 @@ size_t Stream::readBytes(char *buffer, size_t length)
 {
   size_t count = 0;
   while (count < length) {
+    // Copy the available input in bulk, then wait for more.
+    int n = read((uint8_t *)buffer + count, length - count);
+    if (n > 0) {
+      count += n;
+      continue;
+    }
     int c = timedRead();
     if (c < 0) break;
-    *buffer++ = (char)c;
-    count++;
+    buffer[count++] = (char)c;
   }
   return count;
 }
@@ -222,38 +256,242 @@ size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length)
   if (length < 1) return 0;
   size_t index = 0;
   while (index < length) {
+    // Copy the buffered input in bulk up to the terminator, if the stream
+    // gives access to its buffer.
+    if (hasPeekBufferAPI()) {
+      size_t size = peekAvailable();
+      if (size > 0) {
+        if (size > length - index) size = length - index;
+        const char *peeked = peekBuffer();
+        const char *end = (const char *)memchr(peeked, terminator, size);
+        size_t n = (end == nullptr) ? size : end - peeked;
+        memcpy(buffer + index, peeked, n);
+        index += n;
+        if (end != nullptr) {
+          peekConsume(n + 1);
+          break;
+        }
+        peekConsume(n);
+        continue;
+      }
+    }
+
     int c = timedRead();
     if (c < 0 || c == terminator) break;
-    *buffer++ = (char)c;
-    index++;
+    buffer[index++] = (char)c;
   }
   return index; // return number of characters, not including null terminator
 }
 
+namespace {
+
+/**
+ * Aho-Corasick automaton of the targets of findMulti(), stored as a DFA over
+ * the bytes which appear in the targets, so that each byte of the input costs
+ * a single table lookup. With a single target, this is the automaton of the
+ * Knuth-Morris-Pratt algorithm.
+ */
+class MultiMatcher {
+  public:
+    template <typename Target>
+    MultiMatcher(const Target* targets, int count) {
+      // Number the bytes which appear in the targets. Class 0 is for the
+      // other bytes, and the last column holds the target which ends at the
+      // state.
+      memset(classOf, 0, sizeof(classOf));
+      size_t numClasses = 1;
+      size_t total = 0;
+      for (int i = 0; i < count; i++) {
+        const uint8_t* str = (const uint8_t*) targets[i].str;
+        for (size_t j = 0; j < targets[i].len; j++) {
+          if (classOf[str[j]] == 0) classOf[str[j]] = numClasses++;
+        }
+        total += targets[i].len;
+      }
+      matchColumn = numClasses;
+      rowSize = numClasses + 1;
+
+      // The table, then the failure links and the queue used while building.
+      size_t maxStates = total + 1;
+      size_t size = maxStates * (rowSize + 2);
+      table = (size <= sizeof(small) / sizeof(small[0]))
+          ? small : (uint32_t*) malloc(size * sizeof(uint32_t));
+      if (table == nullptr) return;
+
+      // Build the trie. The states are stored as the offsets of their rows.
+      size_t numStates = 1;
+      initRow(0);
+      for (int i = 0; i < count; i++) {
+        const uint8_t* str = (const uint8_t*) targets[i].str;
+        uint32_t state = 0;
+        for (size_t j = 0; j < targets[i].len; j++) {
+          uint32_t& next = table[state + classOf[str[j]]];
+          if (next == kNone) {
+            next = numStates * rowSize;
+            initRow(next);
+            numStates++;
+          }
+          state = next;
+        }
+        // The first of several identical targets wins.
+        if (table[state + matchColumn] == kNone) table[state + matchColumn] = i;
+      }
+
+      // Complete the transitions breadth first, following the failure links.
+      uint32_t* fail = table + maxStates * rowSize;
+      uint32_t* queue = fail + maxStates;
+      size_t head = 0;
+      size_t tail = 0;
+      for (size_t c = 0; c < numClasses; c++) {
+        uint32_t next = table[c];
+        if (next == kNone) {
+          table[c] = 0;
+        } else {
+          fail[next / rowSize] = 0;
+          queue[tail++] = next;
+        }
+      }
+      while (head < tail) {
+        uint32_t state = queue[head++];
+        uint32_t failState = fail[state / rowSize];
+
+        // A target which ends at the failure state also ends here. Report the
+        // lowest index, like the original implementation.
+        uint32_t failMatch = table[failState + matchColumn];
+        if (failMatch < table[state + matchColumn]) {
+          table[state + matchColumn] = failMatch;
+        }
+
+        for (size_t c = 0; c < numClasses; c++) {
+          uint32_t next = table[state + c];
+          if (next == kNone) {
+            table[state + c] = table[failState + c];
+          } else {
+            fail[next / rowSize] = table[failState + c];
+            queue[tail++] = next;
+          }
+        }
+      }
+    }
+
+    ~MultiMatcher() {
+      if (table != small) free(table);
+    }
+
+    MultiMatcher(const MultiMatcher&) = delete;
+    MultiMatcher& operator=(const MultiMatcher&) = delete;
+
+    /** Return false if the table could not be allocated. */
+    bool isValid() const { return table != nullptr; }
+
+    /** Process the byte `c`. Returns the index of the matched target or -1. */
+    int feed(uint8_t c) {
+      state = table[state + classOf[c]];
+      uint32_t match = table[state + matchColumn];
+      return (match == kNone) ? -1 : (int) match;
+    }
+
+    /**
+     * Process up to `size` bytes of `buffer`, and stop after the first match.
+     * Returns the index of the matched target or -1, and the number of bytes
+     * processed in `consumed`.
+     */
+    int scan(const char* buffer, size_t size, size_t* consumed) {
+      const uint8_t* p = (const uint8_t*) buffer;
+      for (size_t i = 0; i < size; i++) {
+        int match = feed(p[i]);
+        if (match >= 0) {
+          *consumed = i + 1;
+          return match;
+        }
+      }
+      *consumed = size;
+      return -1;
+    }
+
+  private:
+    static const uint32_t kNone = UINT32_MAX;
+
+    void initRow(uint32_t row) {
+      for (size_t c = 0; c < rowSize; c++) table[row + c] = kNone;
+    }
+
+    uint32_t classOf[256];
+    size_t matchColumn;
+    size_t rowSize;
+    uint32_t state = 0;
+    uint32_t* table;
+    uint32_t small[512];
+};
+
+} // namespace
+
+void Stream::appendString(String& str, int terminator)
+{
+  char chunk[64];
+  while (true) {
+    // Copy the input which is already available in bulk: up to the
+    // terminator through the peek buffer API, otherwise only if there is no
+    // terminator to stop at.
+    if (hasPeekBufferAPI()) {
+      size_t size = peekAvailable();
+      if (size > 0) {
+        const char *peeked = peekBuffer();
+        const char *end = (terminator < 0) ? nullptr
+            : (const char *)memchr(peeked, terminator, size);
+        size_t n = (end == nullptr) ? size : end - peeked;
+        str.concat(peeked, n);
+        if (end != nullptr) {
+          peekConsume(n + 1);
+          return;
+        }
+        peekConsume(n);
+        continue;
+      }
+    } else if (terminator < 0) {
+      int n = read((uint8_t *)chunk, sizeof(chunk));
+      if (n > 0) {
+        str.concat(chunk, n);
+        continue;
+      }
+    }
+
+    int c = timedRead();
+    if (c < 0 || c == terminator)
+      return;
+    chunk[0] = (char)c;
+    str.concat(chunk, 1);
+  }
+}
+
 String Stream::readString()
 {
   String ret;
-  int c = timedRead();
-  while (c >= 0)
-  {
-    ret += (char)c;
-    c = timedRead();
-  }
+  readString(ret);
   return ret;
 }
 
 String Stream::readStringUntil(char terminator)
 {
   String ret;
-  int c = timedRead();
-  while (c >= 0 && c != terminator)
-  {
-    ret += (char)c;
-    c = timedRead();
-  }
+  readStringUntil(terminator, ret);
   return ret;
 }
 
+size_t Stream::readString(String& str)
+{
+  str = "";
+  appendString(str, -1);
+  return str.length();
+}
+
+size_t Stream::readStringUntil(char terminator, String& str)
+{
+  str = "";
+  appendString(str, (uint8_t)terminator);
+  return str.length();
+}
+
 int Stream::findMulti( struct Stream::MultiTarget *targets, int tCount) {
   // any zero length target string automatically matches and would make
   // a mess of the rest of the algorithm.
@@ -262,59 +500,30 @@ int Stream::findMulti( struct Stream::MultiTarget *targets, int tCount) {
       return t - targets;
   }
 
+  MultiMatcher matcher(targets, tCount);
+  if (! matcher.isValid())
+    return -1;
+
   while (1) {
+    // Scan the input which is already buffered in bulk, if the stream gives
+    // access to its buffer.
+    if (hasPeekBufferAPI()) {
+      size_t size = peekAvailable();
+      if (size > 0) {
+        size_t consumed;
+        int found = matcher.scan(peekBuffer(), size, &consumed);
+        peekConsume(consumed);
+        if (found >= 0)
+          return found;
+        continue;
+      }
+    }
+
     int c = timedRead();
     if (c < 0)
       return -1;
-
-    for (struct MultiTarget *t = targets; t < targets+tCount; ++t) {
-      // the simple case is if we match, deal with that first.
-      if (c == t->str[t->index]) {
-        if (++t->index == t->len)
-          return t - targets;
-        else
-          continue;
-      }
-
-      // if not we need to walk back and see if we could have matched further
-      // down the stream (ie '1112' doesn't match the first position in '11112'
-      // but it will match the second position so we can't just reset the current
-      // index to 0 when we find a mismatch.
-      if (t->index == 0)
-        continue;
-
-      int origIndex = t->index;
-      do {
-        --t->index;
-        // first check if current char works against the new current index
-        if (c != t->str[t->index])
-          continue;
-
-        // if it's the only char then we're good, nothing more to check
-        if (t->index == 0) {
-          t->index++;
-          break;
-        }
-
-        // otherwise we need to check the rest of the found string
-        int diff = origIndex - t->index;
-        size_t i;
-        for (i = 0; i < t->index; ++i) {
-          if (t->str[i] != t->str[i + diff])
-            break;
-        }
-
-        // if we successfully got through the previous loop then our current
-        // index is good.
-        if (i == t->index) {
-          t->index++;
-          break;
-        }
-
-        // otherwise we just try the next index
-      } while (t->index);
-    }
+    int found = matcher.feed(c);
+    if (found >= 0)
+      return found;
   }
-  // unreachable
-  return -1;
 }
@@ -54,13 +54,38 @@ class Stream : public Print
     unsigned long _startMillis;  // used for timeout measurement
     int timedRead();    // read stream with timeout
     int timedPeek();    // peek stream with timeout
+
+    /**
+     * Called by timedRead() and timedPeek() when no data is available. Waits
+     * for more data, for at most `maxMillis` milliseconds. The default calls
+     * yield(). Streams backed by a file descriptor can override it to block
+     * until the input is readable. Available only on EpoxyDuino.
+     */
+    virtual void waitForInput(unsigned long maxMillis);
     int peekNextDigit(LookaheadMode lookahead, bool detectDecimal); // returns the next numeric digit in the stream or -1 if timeout
 
+
+    /**
+     * Append the input to `str` until the byte `terminator`, which is consumed
+     * but not appended, or until the timeout if `terminator` is -1. Copies the
+     * input in bulk when possible.
+     */
+    void appendString(String& str, int terminator);
+
   public:
     virtual int available() = 0;
     virtual int read() = 0;
     virtual int peek() = 0;
 
+    // Reads up to `length` bytes which are available without waiting, and
+    // returns the number of bytes read. Same as the ESP8266 core. The default
+    // calls read() for each byte. Streams with an input buffer override it to
+    // copy the buffer in bulk. Used by readBytes().
+    virtual int read(uint8_t *buffer, size_t length);
+    int read(char *buffer, size_t length) {
+      return read((uint8_t *)buffer, length);
+    }
+
     Stream() {_timeout=1000;}
 
 // parsing methods
@@ -117,6 +142,28 @@ class Stream : public Print
   virtual String readString();
   String readStringUntil(char terminator);
 
+  // Same as readString() and readStringUntil(), but replace the contents of
+  // `str`, reusing its buffer across calls. Returns the length of `str`.
+  // Available only on EpoxyDuino.
+  size_t readString(String& str);
+  size_t readStringUntil(char terminator, String& str);
+
+  // Peek buffer API of the ESP8266 core, which gives direct access to the
+  // input buffer of the stream. Used by find(), findUntil() and findMulti()
+  // to scan the buffered input in bulk.
+
+  // Returns true if the stream implements the other functions below.
+  virtual bool hasPeekBufferAPI() const { return false; }
+
+  // Returns the number of contiguous bytes available at peekBuffer().
+  virtual size_t peekAvailable() { return 0; }
+
+  // Returns a pointer to the next peekAvailable() bytes of the input.
+  virtual const char* peekBuffer() { return nullptr; }
+
+  // Discards the next `consume` bytes, which were inspected by peekBuffer().
+  virtual void peekConsume(size_t consume) { (void) consume; }
+
   protected:
   long parseInt(char ignore) { return parseInt(SKIP_ALL, ignore); }
   float parseFloat(char ignore) { return parseFloat(SKIP_ALL, ignore); }
@@ -132,6 +179,9 @@ class Stream : public Print
 
   // This allows you to search for an arbitrary number of strings.
   // Returns index of the target that is found first or -1 if timeout occurs.
+  // If several targets end at the same character, returns the lowest index.
+  // Uses an Aho-Corasick automaton, so each character is processed in
+  // constant time regardless of the number of targets.
   int findMulti(struct MultiTarget *targets, int tCount);
 };
 
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2026 Brian T. Park
+ * MIT License
+ */
+
+#include "Arduino.h"
+#include "WInterrupts.h"
+
+// The interrupt number is the pin number, because digitalPinToInterrupt() is
+// the identity function, and digitalReadValue() supports only pins < 32.
+#define EPOXY_NUM_INTERRUPTS 32
+
+struct InterruptSlot {
+  void (*func)(void);
+  void (*funcArg)(void*);
+  void* arg;
+  int mode;
+};
+
+struct InterruptRequest {
+  void (*isr)(void*);
+  void* arg;
+};
+
+static InterruptSlot slots[EPOXY_NUM_INTERRUPTS];
+
+// FIFO queue of requests, so that every edge is delivered even if the pin
+// toggles several times before the next dispatch.
+static InterruptRequest queue[EPOXY_INTERRUPT_QUEUE_SIZE];
+static uint8_t queueHead = 0;
+static uint8_t queueSize = 0;
+
+static bool enabled = true;
+static bool dispatching = false;
+
+static bool isAttached(const InterruptSlot& slot) {
+  return slot.func != nullptr || slot.funcArg != nullptr;
+}
+
+// Return true if the 'mode' is triggered while the pin stays at 'val', instead
+// of on an edge.
+static bool isLevelTriggered(int mode, uint8_t val) {
+#if defined(EPOXY_CORE_ESP8266)
+  if (mode == ONLOW || mode == ONLOW_WE) return val == LOW;
+  if (mode == ONHIGH || mode == ONHIGH_WE) return val == HIGH;
+#else
+  if (mode == LOW) return val == LOW;
+#endif
+  return false;
+}
+
+static bool isEdgeTriggered(int mode, uint8_t val) {
+  return mode == CHANGE
+      || (mode == RISING && val == HIGH)
+      || (mode == FALLING && val == LOW);
+}
+
+static void callSlot(void* arg) {
+  const InterruptSlot& slot = *static_cast<InterruptSlot*>(arg);
+  // The handler may have been detached after the request was queued.
+  if (slot.func) {
+    slot.func();
+  } else if (slot.funcArg) {
+    slot.funcArg(slot.arg);
+  }
+}
+
+bool epoxyQueueInterrupt(void (*isr)(void*), void* arg) {
+  if (queueSize >= EPOXY_INTERRUPT_QUEUE_SIZE) return false;
+
+  uint8_t tail = (queueHead + queueSize) % EPOXY_INTERRUPT_QUEUE_SIZE;
+  queue[tail].isr = isr;
+  queue[tail].arg = arg;
+  queueSize++;
+  return true;
+}
+
+void epoxyPinChanged(uint8_t pin, uint8_t val) {
+  if (pin >= EPOXY_NUM_INTERRUPTS) return;
+
+  InterruptSlot& slot = slots[pin];
+  if (isAttached(slot) && isEdgeTriggered(slot.mode, val)) {
+    epoxyQueueInterrupt(callSlot, &slot);
+  }
+}
+
+void epoxyDispatchInterrupts() {
+  if (! enabled || dispatching) return;
+
+  // Disable the interrupts while a handler runs, as on the hardware.
+  dispatching = true;
+  enabled = false;
+
+  // Requests queued by the handlers themselves are dispatched in this pass.
+  while (queueSize > 0) {
+    InterruptRequest request = queue[queueHead];
+    queueHead = (queueHead + 1) % EPOXY_INTERRUPT_QUEUE_SIZE;
+    queueSize--;
+    request.isr(request.arg);
+  }
+
+  for (uint8_t pin = 0; pin < EPOXY_NUM_INTERRUPTS; pin++) {
+    InterruptSlot& slot = slots[pin];
+    if (isAttached(slot) && isLevelTriggered(slot.mode, digitalRead(pin))) {
+      callSlot(&slot);
+    }
+  }
+
+  enabled = true;
+  dispatching = false;
+}
+
+bool epoxyInterruptsEnabled() {
+  return enabled;
+}
+
+// -----------------------------------------------------------------------
+// Arduino functions
+// -----------------------------------------------------------------------
+
+void interrupts() {
+  if (enabled) return;
+  enabled = true;
+  epoxyDispatchInterrupts();
+}
+
+void noInterrupts() {
+  enabled = false;
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode) {
+  if (interruptNum >= EPOXY_NUM_INTERRUPTS) return;
+
+  InterruptSlot& slot = slots[interruptNum];
+  slot.func = userFunc;
+  slot.funcArg = nullptr;
+  slot.arg = nullptr;
+  slot.mode = mode;
+}
+
+#if defined(EPOXY_CORE_ESP8266)
+void attachInterruptArg(uint8_t pin, void (*userFunc)(void*), void* arg,
+    int mode) {
+  if (pin >= EPOXY_NUM_INTERRUPTS) return;
+
+  InterruptSlot& slot = slots[pin];
+  slot.func = nullptr;
+  slot.funcArg = userFunc;
+  slot.arg = arg;
+  slot.mode = mode;
+}
+#endif
+
+void detachInterrupt(uint8_t interruptNum) {
+  if (interruptNum >= EPOXY_NUM_INTERRUPTS) return;
+
+  InterruptSlot& slot = slots[interruptNum];
+  slot.func = nullptr;
+  slot.funcArg = nullptr;
+  slot.arg = nullptr;
+}
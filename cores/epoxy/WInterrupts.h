@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2026 Brian T. Park
+ * MIT License
+ */
+
+/**
+ * @file WInterrupts.h
+ *
+ * Emulation of the external interrupt controller. The handlers registered by
+ * `attachInterrupt()` are not called directly when a pin changes through
+ * `digitalReadValue()`. Instead, the request is queued, and the handlers are
+ * called at the next `yield()` or `delay()` (which includes the `yield()`
+ * between 2 iterations of `loop()`), or when `interrupts()` re-enables them.
+ * The handlers are called with the interrupts disabled, as on the hardware.
+ *
+ * These functions are used by other parts of the EpoxyDuino core and the mock
+ * libraries. They are available only on EpoxyDuino.
+ */
+
+#ifndef EPOXY_DUINO_WINTERRUPTS_H
+#define EPOXY_DUINO_WINTERRUPTS_H
+
+#include <stdint.h>
+
+/** Maximum number of interrupt requests waiting to be dispatched. */
+#define EPOXY_INTERRUPT_QUEUE_SIZE 64
+
+/**
+ * Queue an interrupt request which calls `isr(arg)` at the next dispatch.
+ * Returns false if the queue is full, in which case the request is lost, like
+ * an interrupt which is missed on the hardware.
+ */
+bool epoxyQueueInterrupt(void (*isr)(void*), void* arg);
+
+/**
+ * Called by `digitalReadValue()` when the value of `pin` changes, to queue the
+ * handler attached to the pin if the edge matches its mode.
+ */
+void epoxyPinChanged(uint8_t pin, uint8_t val);
+
+/**
+ * Call the handlers of the queued interrupt requests, and those of the level
+ * triggered pins, unless the interrupts are disabled by `noInterrupts()`.
+ */
+void epoxyDispatchInterrupts();
+
+/** Return true unless the interrupts are disabled by `noInterrupts()`. */
+bool epoxyInterruptsEnabled();
+
+#endif
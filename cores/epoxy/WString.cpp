@@ -122,7 +122,7 @@ String::String(double value, unsigned char decimalPlaces)
 
 String::~String()
 {
-	free(buffer);
+	if (buffer && buffer != inlineBuffer) free(buffer);
 }
 
 /*********************************************/
@@ -138,7 +138,7 @@ inline void String::init(void)
 
 void String::invalidate(void)
 {
-	if (buffer) free(buffer);
+	if (buffer != inlineBuffer) free(buffer);
 	buffer = NULL;
 	capacity = len = 0;
 }
@@ -153,9 +153,43 @@ unsigned char String::reserve(unsigned int size)
 	return 0;
 }
 
+unsigned char String::growBuffer(unsigned int minStrLen)
+{
+	if (buffer && capacity >= minStrLen) return 1;
+	// grow by at least half of the capacity, so that a loop of concatenations
+	// reallocates only O(log n) times
+	unsigned int grown = capacity + capacity / 2;
+	if (grown > minStrLen && reserve(grown)) return 1;
+	return reserve(minStrLen);
+}
+
+unsigned char String::shrinkToFit(void)
+{
+	if (!buffer || buffer == inlineBuffer || capacity == len) return 1;
+	return changeBuffer(len);
+}
+
 unsigned char String::changeBuffer(unsigned int maxStrLen)
 {
-	char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
+	if (maxStrLen <= EPOXY_STRING_INLINE_CAPACITY) {
+		if (buffer != inlineBuffer) {
+			if (buffer) {
+				memcpy(inlineBuffer, buffer, len + 1);
+				free(buffer);
+			}
+			buffer = inlineBuffer;
+		}
+		capacity = EPOXY_STRING_INLINE_CAPACITY;
+		return 1;
+	}
+
+	char *newbuffer;
+	if (buffer == inlineBuffer) {
+		newbuffer = (char *)malloc(maxStrLen + 1);
+		if (newbuffer) memcpy(newbuffer, inlineBuffer, len + 1);
+	} else {
+		newbuffer = (char *)realloc(buffer, maxStrLen + 1);
+	}
 	if (newbuffer) {
 		buffer = newbuffer;
 		capacity = maxStrLen;
@@ -175,7 +209,9 @@ String & String::copy(const char *cstr, unsigned int length)
 		return *this;
 	}
 	len = length;
-	strcpy(buffer, cstr);
+	// cstr may be a part of the buffer itself
+	memmove(buffer, cstr, length);
+	buffer[len] = 0;
 	return *this;
 }
 
@@ -186,29 +222,36 @@ String & String::copy(const __FlashStringHelper *pstr, unsigned int length)
 		return *this;
 	}
 	len = length;
-	strcpy_P(buffer, (PGM_P)pstr);
+	memcpy_P(buffer, (PGM_P)pstr, length);
+	buffer[len] = 0;
 	return *this;
 }
 
 #if __cplusplus >= 201103L || defined(__GXX_EXPERIMENTAL_CXX0X__)
 void String::move(String &rhs)
 {
-	if (buffer) {
-		if (rhs && capacity >= rhs.len) {
-			strcpy(buffer, rhs.buffer);
-			len = rhs.len;
-			rhs.len = 0;
-			return;
-		} else {
-			free(buffer);
+	if (rhs.buffer != rhs.inlineBuffer) {
+		// take over the heap buffer of rhs, or its invalid state
+		if (buffer && buffer != inlineBuffer) free(buffer);
+		buffer = rhs.buffer;
+		capacity = rhs.capacity;
+		len = rhs.len;
+	} else {
+		// the inline buffer cannot be taken over, so copy its contents. every
+		// buffer is at least as large as the inline buffer.
+		if (!buffer) {
+			buffer = inlineBuffer;
+			capacity = EPOXY_STRING_INLINE_CAPACITY;
 		}
+		memcpy(buffer, rhs.buffer, rhs.len + 1);
+		len = rhs.len;
 	}
-	buffer = rhs.buffer;
-	capacity = rhs.capacity;
-	len = rhs.len;
-	rhs.buffer = NULL;
-	rhs.capacity = 0;
+
+	// leave rhs a valid empty string in its inline buffer
+	rhs.buffer = rhs.inlineBuffer;
+	rhs.capacity = EPOXY_STRING_INLINE_CAPACITY;
 	rhs.len = 0;
+	rhs.inlineBuffer[0] = 0;
 }
 #endif
 
@@ -266,9 +309,17 @@ unsigned char String::concat(const char *cstr, unsigned int length)
 	unsigned int newlen = len + length;
 	if (!cstr) return 0;
 	if (length == 0) return 1;
-	if (!reserve(newlen)) return 0;
-	strcpy(buffer + len, cstr);
+	// cstr may point into the buffer (e.g. s += s), which reserve() can move
+	if (buffer && cstr >= buffer && cstr < buffer + len) {
+		unsigned int offset = cstr - buffer;
+		if (!growBuffer(newlen)) return 0;
+		cstr = buffer + offset;
+	} else if (!growBuffer(newlen)) {
+		return 0;
+	}
+	memcpy(buffer + len, cstr, length);
 	len = newlen;
+	buffer[len] = 0;
 	return 1;
 }
 
@@ -341,9 +392,10 @@ unsigned char String::concat(const __FlashStringHelper * str)
 	int length = strlen_P((const char *) str);
 	if (length == 0) return 1;
 	unsigned int newlen = len + length;
-	if (!reserve(newlen)) return 0;
-	strcpy_P(buffer + len, (const char *) str);
+	if (!growBuffer(newlen)) return 0;
+	memcpy_P(buffer + len, (const char *) str, length);
 	len = newlen;
+	buffer[len] = 0;
 	return 1;
 }
 
@@ -30,6 +30,13 @@
 #include "pgmspace.h"
 #include "avr_stdlib.h"
 
+// Strings up to this many characters are stored in a buffer inside the
+// String object, and only longer strings are allocated on the heap. The
+// default holds any 64-bit integer converted to a String.
+#ifndef EPOXY_STRING_INLINE_CAPACITY
+  #define EPOXY_STRING_INLINE_CAPACITY 23
+#endif
+
 // Macros for creating and using c-strings in PROGMEM.
 // FPSTR() is defined for ESP8266 and ESP32 Cores, but not AVR or SAMD Cores.
 class __FlashStringHelper;
@@ -78,6 +85,11 @@ public:
 	// invalid string (i.e., "if (s)" will be true afterwards)
 	unsigned char reserve(unsigned int size);
 	inline unsigned int length(void) const {return len;}
+	// the concatenations grow the buffer geometrically, so it can be larger
+	// than the string. shrinkToFit() releases the unused part, or moves a
+	// short string into the buffer inside the object. returns true on
+	// success, false on failure (the string is left unchanged).
+	unsigned char shrinkToFit(void);
 
 	// creates a copy of the assigned value.  if the value is null or
 	// invalid, or if the memory allocation fails, the string will be
@@ -97,6 +109,9 @@ public:
 	// concatenation is considered unsucessful.
 	unsigned char concat(const String &str);
 	unsigned char concat(const char *cstr);
+	// appends exactly `length` bytes of `cstr`, which may contain NUL
+	// characters (same as the ESP8266 core)
+	unsigned char concat(const char *cstr, unsigned int length);
 	unsigned char concat(char c);
 	unsigned char concat(unsigned char c);
 	unsigned char concat(int num);
@@ -192,14 +207,15 @@ public:
 	double toDouble(void) const;
 
 protected:
-	char *buffer;	        // the actual char array
+	char *buffer;	        // the actual char array, inlineBuffer or heap
 	unsigned int capacity;  // the array length minus one (for the '\0')
 	unsigned int len;       // the String length (not counting the '\0')
+	char inlineBuffer[EPOXY_STRING_INLINE_CAPACITY + 1];
 protected:
 	void init(void);
 	void invalidate(void);
 	unsigned char changeBuffer(unsigned int maxStrLen);
-	unsigned char concat(const char *cstr, unsigned int length);
+	unsigned char growBuffer(unsigned int minStrLen);
 
 	// copy and move
 	String & copy(const char *cstr, unsigned int length);
@@ -22,9 +22,11 @@
 #include <signal.h> // SIGINT
 #include <stdlib.h> // exit()
 #include <stdio.h> // perror()
+#include <string.h> // strcmp()
 #include <unistd.h> // isatty(), STDIN_FILENO, STDOUT_FILENO
 #include <fcntl.h>
 #include <termios.h>
+#include <time.h> // clock_gettime()
 
 // -----------------------------------------------------------------------
 // Unix compatibility. Put STDIN into raw mode and hook it into the 'Serial'
@@ -106,6 +108,264 @@ static void enableRawMode() {
   inNonBlockingMode = true;
 }
 
+// -----------------------------------------------------------------------
+// Runtime configuration through environment variables.
+// -----------------------------------------------------------------------
+
+/** Return true if the environment variable is set to anything other than 0. */
+static bool isEnvEnabled(const char* name) {
+  const char* value = getenv(name);
+  return value != NULL && value[0] != '\0' && strcmp(value, "0") != 0;
+}
+
+static void setupVirtualTime() {
+  if (isEnvEnabled("EPOXY_VIRTUAL_TIME")) {
+    enableVirtualTime();
+  }
+
+  const char* quantum = getenv("EPOXY_VIRTUAL_TIME_QUANTUM");
+  if (quantum != NULL && quantum[0] != '\0') {
+    setVirtualTimeQuantum(strtoul(quantum, NULL, 10));
+  }
+}
+
+static void setupClockSource() {
+  const char* clock = getenv("EPOXY_CLOCK");
+  if (clock == NULL || clock[0] == '\0') return;
+
+  EpoxyClockSource source;
+  if (strcmp(clock, "auto") == 0) {
+    source = EPOXY_CLOCK_AUTO;
+  } else if (strcmp(clock, "monotonic") == 0) {
+    source = EPOXY_CLOCK_MONOTONIC;
+  } else if (strcmp(clock, "coarse") == 0) {
+    source = EPOXY_CLOCK_COARSE;
+  } else if (strcmp(clock, "tsc") == 0) {
+    source = EPOXY_CLOCK_TSC;
+  } else {
+    fprintf(stderr, "Unknown EPOXY_CLOCK '%s' ignored\n", clock);
+    return;
+  }
+
+  if (! setClockSource(source)) {
+    fprintf(stderr, "EPOXY_CLOCK '%s' not available, using 'monotonic'\n",
+        clock);
+  }
+}
+
+static void setupYieldMode() {
+  const char* mode = getenv("EPOXY_YIELD_MODE");
+  if (mode == NULL || mode[0] == '\0') return;
+
+  if (strcmp(mode, "sleep") == 0) {
+    setYieldMode(EPOXY_YIELD_SLEEP);
+  } else if (strcmp(mode, "spin") == 0) {
+    setYieldMode(EPOXY_YIELD_SPIN);
+  } else if (strcmp(mode, "adaptive") == 0) {
+    setYieldMode(EPOXY_YIELD_ADAPTIVE);
+  } else {
+    fprintf(stderr, "Unknown EPOXY_YIELD_MODE '%s' ignored\n", mode);
+  }
+}
+
+static void setupBaudEmulation() {
+  const char* mode = getenv("EPOXY_SERIAL_BAUD");
+  if (mode == NULL || mode[0] == '\0') return;
+
+  EpoxyBaudEmulation emulation;
+  if (strcmp(mode, "off") == 0) {
+    emulation = EPOXY_BAUD_OFF;
+  } else if (strcmp(mode, "block") == 0) {
+    emulation = EPOXY_BAUD_BLOCK;
+  } else if (strcmp(mode, "drop") == 0) {
+    emulation = EPOXY_BAUD_DROP;
+  } else {
+    fprintf(stderr, "Unknown EPOXY_SERIAL_BAUD '%s' ignored\n", mode);
+    return;
+  }
+  Serial.setBaudEmulation(emulation);
+  Serial1.setBaudEmulation(emulation);
+  Serial2.setBaudEmulation(emulation);
+  Serial3.setBaudEmulation(emulation);
+}
+
+static void setupWriterThread() {
+  const char* mode = getenv("EPOXY_SERIAL_WRITER");
+  if (mode == NULL || mode[0] == '\0') return;
+
+  EpoxyWriterPolicy policy;
+  if (strcmp(mode, "off") == 0) {
+    policy = EPOXY_WRITER_OFF;
+  } else if (strcmp(mode, "block") == 0) {
+    policy = EPOXY_WRITER_BLOCK;
+  } else if (strcmp(mode, "drop-oldest") == 0) {
+    policy = EPOXY_WRITER_DROP_OLDEST;
+  } else if (strcmp(mode, "drop-newest") == 0) {
+    policy = EPOXY_WRITER_DROP_NEWEST;
+  } else {
+    fprintf(stderr, "Unknown EPOXY_SERIAL_WRITER '%s' ignored\n", mode);
+    return;
+  }
+  Serial.startWriterThread(policy);
+}
+
+static void setupSerialTrace() {
+  const char* tracePath = getenv("EPOXY_SERIAL_TRACE");
+  if (tracePath != NULL && tracePath[0] != '\0') {
+    Serial.startTrace(tracePath);
+  }
+
+  const char* replayPath = getenv("EPOXY_SERIAL_REPLAY");
+  if (replayPath == NULL || replayPath[0] == '\0') return;
+
+  bool realtime = true;
+  const char* speed = getenv("EPOXY_SERIAL_REPLAY_SPEED");
+  if (speed == NULL || speed[0] == '\0' || strcmp(speed, "realtime") == 0) {
+    realtime = true;
+  } else if (strcmp(speed, "fast") == 0) {
+    realtime = false;
+  } else {
+    fprintf(stderr, "Unknown EPOXY_SERIAL_REPLAY_SPEED '%s' ignored\n", speed);
+  }
+  Serial.startReplay(replayPath, realtime);
+}
+
+/**
+ * Connect the serial port to the device given by the environment variable,
+ * and print the path of the device, which is needed for a pseudo-terminal.
+ */
+static void setupSerialPort(FdSerial& serial, const char* name,
+    const char* envName) {
+  const char* spec = getenv(envName);
+  if (spec == NULL || spec[0] == '\0') return;
+
+  if (serial.open(spec)) {
+    fprintf(stderr, "%s: %s\n", name, serial.getPath());
+  }
+}
+
+// -----------------------------------------------------------------------
+// Optional loop() instrumentation, enabled by EPOXY_LOOP_STATS=1 or
+// EPOXY_LOOP_STATS_FILE={path}. The execution time of each loop() is
+// recorded in a log-bucketed histogram (8 sub-buckets per power of 2, so
+// within 12.5% of the true value), and a summary is printed at exit or upon
+// SIGINT. The times come from CLOCK_MONOTONIC, independent of the virtual
+// clock and of the clock source of millis().
+// -----------------------------------------------------------------------
+
+// Bucket index of the largest uint64_t value is 61 * 8 + 7.
+static const int LOOP_STATS_NUM_BUCKETS = 62 * 8;
+
+static bool loopStatsEnabled = false;
+static const char* loopStatsFile = NULL;
+static uint64_t loopStatsBuckets[LOOP_STATS_NUM_BUCKETS];
+static uint64_t loopStatsCount = 0;
+static uint64_t loopStatsMaxNanos = 0;
+static uint64_t loopStatsStartNanos = 0;
+static volatile sig_atomic_t loopStatsInterrupted = 0;
+
+static uint64_t nowNanos() {
+  struct timespec spec;
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  return (uint64_t) spec.tv_sec * 1000000000 + spec.tv_nsec;
+}
+
+/** Values 0-7 get their own bucket, then 8 sub-buckets per power of 2. */
+static int loopStatsBucket(uint64_t nanos) {
+  if (nanos < 8) return (int) nanos;
+  int msb = 63 - __builtin_clzll(nanos);
+  int sub = (int) ((nanos >> (msb - 3)) & 0x7);
+  return (msb - 2) * 8 + sub;
+}
+
+/** Largest value which falls into the given bucket. */
+static uint64_t loopStatsBucketMax(int bucket) {
+  if (bucket < 8) return bucket;
+  int msb = bucket / 8 + 2;
+  uint64_t lower = (uint64_t) (8 + bucket % 8) << (msb - 3);
+  return lower + ((uint64_t) 1 << (msb - 3)) - 1;
+}
+
+/** Return the upper bound of the bucket containing the given percentile. */
+static uint64_t loopStatsPercentile(double percentile) {
+  uint64_t rank = (uint64_t) (percentile / 100.0 * loopStatsCount);
+  if (rank >= loopStatsCount) rank = loopStatsCount - 1;
+  uint64_t seen = 0;
+  for (int i = 0; i < LOOP_STATS_NUM_BUCKETS; i++) {
+    seen += loopStatsBuckets[i];
+    if (seen > rank) {
+      uint64_t value = loopStatsBucketMax(i);
+      return (value < loopStatsMaxNanos) ? value : loopStatsMaxNanos;
+    }
+  }
+  return loopStatsMaxNanos;
+}
+
+static void printLoopStats() {
+  FILE* out = stderr;
+  if (loopStatsFile != NULL) {
+    out = fopen(loopStatsFile, "w");
+    if (out == NULL) {
+      perror("printLoopStats(): fopen() failure");
+      return;
+    }
+  }
+
+  double elapsedSeconds = (nowNanos() - loopStatsStartNanos) / 1e9;
+  fprintf(out, "loop() iterations: %llu in %.3f s (%.1f/s)\n",
+      (unsigned long long) loopStatsCount, elapsedSeconds,
+      (elapsedSeconds > 0) ? loopStatsCount / elapsedSeconds : 0.0);
+  if (loopStatsCount > 0) {
+    fprintf(out,
+        "loop() latency (us): p50 %.3f, p99 %.3f, p999 %.3f, max %.3f\n",
+        loopStatsPercentile(50) / 1e3,
+        loopStatsPercentile(99) / 1e3,
+        loopStatsPercentile(99.9) / 1e3,
+        loopStatsMaxNanos / 1e3);
+  }
+
+  if (out != stderr) fclose(out);
+}
+
+// Let the current loop() finish, then exit() normally so that the stats are
+// printed by the atexit() handler. A second Ctrl-C kills the program as usual,
+// in case loop() never returns.
+static void handleLoopStatsSigint(int /*sig*/) {
+  loopStatsInterrupted = 1;
+}
+
+static void setupLoopStats() {
+  loopStatsFile = getenv("EPOXY_LOOP_STATS_FILE");
+  if (loopStatsFile != NULL && loopStatsFile[0] == '\0') loopStatsFile = NULL;
+  loopStatsEnabled = isEnvEnabled("EPOXY_LOOP_STATS") || loopStatsFile != NULL;
+  if (! loopStatsEnabled) return;
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handleLoopStatsSigint;
+  action.sa_flags = SA_RESETHAND;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, NULL);
+
+  atexit(printLoopStats);
+}
+
+static void runLoopWithStats() {
+  loopStatsStartNanos = nowNanos();
+  while (true) {
+    uint64_t start = nowNanos();
+    loop();
+    uint64_t elapsed = nowNanos() - start;
+
+    loopStatsBuckets[loopStatsBucket(elapsed)]++;
+    loopStatsCount++;
+    if (elapsed > loopStatsMaxNanos) loopStatsMaxNanos = elapsed;
+
+    if (loopStatsInterrupted) exit(128 + SIGINT);
+    yield();
+  }
+}
+
 // -----------------------------------------------------------------------
 // Main loop. User code will provide setup() and loop().
 // -----------------------------------------------------------------------
@@ -116,14 +376,35 @@ int epoxy_argc;
 
 const char* const* epoxy_argv;
 
+static EpoxyYieldMode yieldMode = EPOXY_YIELD_SLEEP;
+
+void setYieldMode(EpoxyYieldMode mode) {
+  yieldMode = mode;
+}
+
+EpoxyYieldMode getYieldMode() {
+  return yieldMode;
+}
+
 static int epoxyduino_main(int argc, char** argv) {
   epoxy_argc = argc;
   epoxy_argv = argv;
 
   atexit(disableRawMode);
   enableRawMode();
+  setupVirtualTime();
+  setupClockSource();
+  setupYieldMode();
+  setupSerialPort(Serial1, "Serial1", "EPOXY_SERIAL1");
+  setupSerialPort(Serial2, "Serial2", "EPOXY_SERIAL2");
+  setupSerialPort(Serial3, "Serial3", "EPOXY_SERIAL3");
+  setupBaudEmulation();
+  setupWriterThread();
+  setupSerialTrace();
+  setupLoopStats();
 
   setup();
+  if (loopStatsEnabled) runLoopWithStats();
   while (true) {
     loop();
     yield();
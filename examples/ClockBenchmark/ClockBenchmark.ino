@@ -0,0 +1,82 @@
+/*
+ * Measure the cost of millis() and micros() in nanoseconds per call for each
+ * clock source supported by EpoxyDuino (see setClockSource()). The elapsed
+ * time of each run is measured directly using CLOCK_MONOTONIC, independent of
+ * the clock source under test.
+ *
+ * On Linux or Mac, type:
+ *  * $ make
+ *  * $ ./ClockBenchmark.out
+ *
+ * Results in nanoseconds per call on an Intel Xeon VM, Debian 12, g++ 12.2
+ * (CLOCK_MONOTONIC_COARSE has only 4 ms resolution on this kernel, so it is
+ * rejected):
+ *
+ * ```
+ * BENCHMARKS
+ * source millis() micros()
+ * monotonic 52.1 53.0
+ * coarse not available
+ * tsc 34.7 34.7
+ * END
+ * ```
+ */
+
+#include <Arduino.h>
+#include <time.h> // clock_gettime()
+
+#if ! defined(EPOXY_DUINO)
+  #error This benchmark is specific to EpoxyDuino
+#endif
+
+const unsigned long NUM_CALLS = 5000000;
+
+// Prevent the compiler from optimizing away the calls.
+volatile unsigned long sink;
+
+static uint64_t nowNanos() {
+  struct timespec spec;
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  return (uint64_t) spec.tv_sec * 1000000000 + spec.tv_nsec;
+}
+
+static double nanosPerCall(unsigned long (*clock)()) {
+  unsigned long sum = 0;
+  uint64_t start = nowNanos();
+  for (unsigned long i = 0; i < NUM_CALLS; i++) {
+    sum += clock();
+  }
+  uint64_t elapsed = nowNanos() - start;
+  sink = sum;
+  return (double) elapsed / NUM_CALLS;
+}
+
+static void runBenchmark(const char* label, EpoxyClockSource source) {
+  SERIAL_PORT_MONITOR.print(label);
+  if (! setClockSource(source)) {
+    SERIAL_PORT_MONITOR.println(" not available");
+    return;
+  }
+
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(nanosPerCall(millis), 1);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(nanosPerCall(micros), 1);
+  SERIAL_PORT_MONITOR.println();
+}
+
+void setup() {
+  SERIAL_PORT_MONITOR.begin(115200);
+  SERIAL_PORT_MONITOR.setLineModeUnix();
+
+  SERIAL_PORT_MONITOR.println(F("BENCHMARKS"));
+  SERIAL_PORT_MONITOR.println(F("source millis() micros()"));
+  runBenchmark("monotonic", EPOXY_CLOCK_MONOTONIC);
+  runBenchmark("coarse", EPOXY_CLOCK_COARSE);
+  runBenchmark("tsc", EPOXY_CLOCK_TSC);
+  SERIAL_PORT_MONITOR.println(F("END"));
+
+  exit(0);
+}
+
+void loop() {}
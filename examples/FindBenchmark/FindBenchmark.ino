@@ -0,0 +1,180 @@
+/*
+ * Measure the cost of Stream::findMulti() in nanoseconds per byte of input,
+ * as a function of the number of targets. The input is random lowercase text
+ * which contains the last target only at its end, and the targets are random
+ * lowercase words of 8 letters. Three implementations are compared:
+ *
+ *  * legacy: a copy of the original findMulti(), which compares each byte
+ *    with every target, and walks back through a target on a mismatch
+ *  * byte: the automaton of findMulti(), reading one byte at a time using
+ *    timedRead(), which is what happens with a stream without the peek
+ *    buffer API
+ *  * bulk: the automaton of findMulti(), scanning the buffer of the
+ *    MemoryStream in place using the peek buffer API
+ *
+ * On Linux or Mac, type:
+ *  * $ make
+ *  * $ ./FindBenchmark.out
+ *
+ * Results in nanoseconds per byte on an Intel Xeon VM, Debian 12, g++ 12.2.
+ * The cost of the legacy code grows with the number of targets. The byte
+ * method does not, and is dominated by the call to millis() in timedRead():
+ *
+ * ```
+ * BENCHMARKS
+ * targets legacy byte bulk
+ * 1 33.9 35.6 2.4
+ * 2 33.6 35.6 2.4
+ * 4 35.8 36.4 2.4
+ * 8 41.5 36.5 2.5
+ * 16 51.7 35.9 2.6
+ * END
+ * ```
+ */
+
+#include <Arduino.h>
+#include <MemoryStream.h>
+#include <time.h> // clock_gettime()
+
+#if ! defined(EPOXY_DUINO)
+  #error This benchmark is specific to EpoxyDuino
+#endif
+
+const size_t INPUT_SIZE = 16384;
+const unsigned long NUM_LOOPS = 100;
+const double NUM_BYTES = (double) INPUT_SIZE * NUM_LOOPS;
+const int MAX_TARGETS = 16;
+const size_t TARGET_SIZE = 8;
+
+// Prevent the compiler from optimizing away the searches.
+volatile int sink;
+
+char input[INPUT_SIZE];
+char words[MAX_TARGETS][TARGET_SIZE + 1];
+
+/** A MemoryStream which gives access to findMulti() and its original code. */
+class FindStream: public MemoryStream {
+  public:
+    using Stream::MultiTarget;
+    using Stream::findMulti;
+
+    /** The original implementation of findMulti(). */
+    int legacyFindMulti(MultiTarget* targets, int tCount) {
+      while (1) {
+        int c = timedRead();
+        if (c < 0)
+          return -1;
+
+        for (MultiTarget* t = targets; t < targets+tCount; ++t) {
+          if (c == t->str[t->index]) {
+            if (++t->index == t->len)
+              return t - targets;
+            else
+              continue;
+          }
+
+          if (t->index == 0)
+            continue;
+
+          int origIndex = t->index;
+          do {
+            --t->index;
+            if (c != t->str[t->index])
+              continue;
+
+            if (t->index == 0) {
+              t->index++;
+              break;
+            }
+
+            int diff = origIndex - t->index;
+            size_t i;
+            for (i = 0; i < t->index; ++i) {
+              if (t->str[i] != t->str[i + diff])
+                break;
+            }
+
+            if (i == t->index) {
+              t->index++;
+              break;
+            }
+          } while (t->index);
+        }
+      }
+    }
+};
+
+/** A FindStream without the peek buffer API, read one byte at a time. */
+class BytewiseStream: public FindStream {
+  public:
+    bool hasPeekBufferAPI() const override { return false; }
+};
+
+enum Method { LEGACY, BYTE, BULK };
+
+static uint64_t nowNanos() {
+  struct timespec spec;
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  return (uint64_t) spec.tv_sec * 1000000000 + spec.tv_nsec;
+}
+
+static double nanosPerByte(Method method, int count) {
+  FindStream bulkStream;
+  BytewiseStream byteStream;
+  FindStream& stream = (method == BYTE) ? byteStream : bulkStream;
+  stream.setTimeout(0);
+
+  // The last target appears only at the end of the input.
+  memcpy(input + INPUT_SIZE - TARGET_SIZE, words[count - 1], TARGET_SIZE);
+
+  FindStream::MultiTarget targets[MAX_TARGETS];
+  int sum = 0;
+  uint64_t elapsed = 0;
+  for (unsigned long i = 0; i < NUM_LOOPS; i++) {
+    stream.write(input, INPUT_SIZE);
+    for (int t = 0; t < count; t++) {
+      targets[t].str = words[t];
+      targets[t].len = TARGET_SIZE;
+      targets[t].index = 0;
+    }
+
+    uint64_t start = nowNanos();
+    sum += (method == LEGACY)
+        ? stream.legacyFindMulti(targets, count)
+        : stream.findMulti(targets, count);
+    elapsed += nowNanos() - start;
+    stream.clear();
+  }
+  sink = sum;
+  return elapsed / NUM_BYTES;
+}
+
+void setup() {
+  SERIAL_PORT_MONITOR.begin(115200);
+  SERIAL_PORT_MONITOR.setLineModeUnix();
+
+  randomSeed(1);
+  for (size_t i = 0; i < INPUT_SIZE; i++) input[i] = 'a' + random(26);
+  for (int t = 0; t < MAX_TARGETS; t++) {
+    for (size_t i = 0; i < TARGET_SIZE; i++) words[t][i] = 'a' + random(26);
+    words[t][TARGET_SIZE] = '\0';
+  }
+
+  SERIAL_PORT_MONITOR.println(F("BENCHMARKS"));
+  SERIAL_PORT_MONITOR.println(F("targets legacy byte bulk"));
+  for (int count = 1; count <= MAX_TARGETS; count *= 2) {
+    SERIAL_PORT_MONITOR.print(count);
+    SERIAL_PORT_MONITOR.print(' ');
+    SERIAL_PORT_MONITOR.print(nanosPerByte(LEGACY, count), 1);
+    SERIAL_PORT_MONITOR.print(' ');
+    SERIAL_PORT_MONITOR.print(nanosPerByte(BYTE, count), 1);
+    SERIAL_PORT_MONITOR.print(' ');
+    SERIAL_PORT_MONITOR.print(nanosPerByte(BULK, count), 1);
+    SERIAL_PORT_MONITOR.println();
+  }
+  SERIAL_PORT_MONITOR.println(F("END"));
+
+  exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,253 @@
+/*
+ * Measure the cost of the print() and println() methods of the Print class in
+ * nanoseconds per statement, and count the number of calls to the virtual
+ * write() methods of the sink per statement. The "null" sink overrides both
+ * write(uint8_t) and write(const uint8_t*, size_t), and discards the data, so
+ * that only the cost of formatting and of the calls is measured. The "serial"
+ * sink is the StdioSerial `Serial`, writing to /dev/null.
+ *
+ * On Linux or Mac, type:
+ *  * $ make
+ *  * $ ./PrintBenchmark.out
+ *
+ * The "batch" statements print a batch of numbers of random magnitudes, and
+ * the "legacy" statements print the same batch using a copy of the original
+ * conversion, with one % and one / per digit.
+ *
+ * Results in nanoseconds per statement on an Intel Xeon VM, Debian 12, g++
+ * 12.2, -O2.
+ *
+ * Before assembling the output in a stack buffer (one write(uint8_t) per
+ * character for F() strings and floats), and before the digit tables:
+ *
+ * ```
+ * BENCHMARKS
+ * statement null serial writes
+ * print(long) 16.6 26.7 2.0
+ * println(long) 22.5 44.3 3.0
+ * print(ulong,HEX) 20.6 20.9 1.0
+ * println(double) 37.3 55.9 5.0
+ * print(const char*) 2.6 11.2 1.0
+ * println(const char*) 5.4 19.9 2.0
+ * println(F()) 30.5 71.3 13.0
+ * println(String) 4.9 18.1 2.0
+ * legacy(ulong) 40.0 49.2 1.0
+ * batch(ulong) 17.6 25.4 1.0
+ * legacy(ulong,HEX) 32.8 44.2 1.0
+ * batch(ulong,HEX) 15.1 22.4 1.0
+ * END
+ * ```
+ *
+ * Before the exact conversion of floating point numbers, which printed "ovf"
+ * above 4294967040, batch(double) took 15.0 ns and batch(double,6) took 34.4
+ * ns on the null sink.
+ *
+ * Before the printf() engine, the printf() statement formatted into a 250
+ * byte buffer using vsnprintf(), in 117.4 ns on the null sink. The format()
+ * statement prints the same output from a format string parsed at compile
+ * time. Before it assembled the pieces in a stack buffer, it used one write()
+ * per piece, in 26.4 ns on the null sink and 66.7 ns on the serial sink, with
+ * 5.0 writes.
+ *
+ * After:
+ *
+ * ```
+ * BENCHMARKS
+ * statement null serial writes
+ * print(long) 11.5 19.0 1.0
+ * println(long) 12.7 20.5 1.0
+ * print(ulong,HEX) 12.6 19.1 1.0
+ * println(double) 14.6 20.3 1.0
+ * print(const char*) 2.1 9.6 1.0
+ * println(const char*) 3.3 10.8 1.0
+ * println(F()) 8.9 17.2 1.0
+ * println(String) 7.5 15.3 1.0
+ * legacy(ulong) 36.9 47.3 1.0
+ * batch(ulong) 13.3 22.5 1.0
+ * legacy(ulong,HEX) 30.8 39.7 1.0
+ * batch(ulong,HEX) 13.0 22.0 1.0
+ * batch(ulonglong) 13.1 22.7 1.0
+ * batch(double) 13.5 20.5 1.0
+ * batch(double,6) 16.9 23.5 1.0
+ * printf(%ld %lX %s) 104.6 114.3 1.0
+ * format({} {:X} {}) 24.0 33.7 1.0
+ * END
+ * ```
+ */
+
+#include <Arduino.h>
+#include <fcntl.h> // open()
+#include <time.h> // clock_gettime()
+#include <unistd.h> // dup(), dup2()
+
+#if ! defined(EPOXY_DUINO)
+  #error This benchmark is specific to EpoxyDuino
+#endif
+
+const unsigned long NUM_STATEMENTS = 1000000;
+
+/** A Print which counts the calls to write() and discards the data. */
+class NullPrint: public Print {
+  public:
+    size_t write(uint8_t) override {
+      writeCount++;
+      return 1;
+    }
+
+    size_t write(const uint8_t* /*buffer*/, size_t size) override {
+      writeCount++;
+      return size;
+    }
+
+    using Print::write;
+
+    unsigned long writeCount = 0;
+};
+
+NullPrint sink;
+
+// Prevent the compiler from optimizing away the arguments.
+volatile long longValue = -1234567;
+volatile unsigned long hexValue = 0xDEADBEEF;
+volatile double doubleValue = 3.14159;
+
+// A batch of numbers of random magnitudes, from 1 to 64 bits, and a batch of
+// doubles from 0.001 to 100000, like sensor readings.
+const size_t NUM_VALUES = 1024;
+unsigned long long values[NUM_VALUES];
+double doubleValues[NUM_VALUES];
+size_t valueIndex = 0;
+
+static void initValues() {
+  uint64_t x = 88172645463325252ULL;
+  for (size_t i = 0; i < NUM_VALUES; i++) {
+    // xorshift64
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    int bits = i % 64 + 1;
+    values[i] = (bits == 64) ? x : x & ((1ULL << bits) - 1);
+
+    static const double scales[] = {1e-2, 1e-1, 1, 1e1, 1e2, 1e3, 1e4, 1e5};
+    doubleValues[i] = (x >> 11) * 0x1p-53 * scales[i % 8];
+  }
+}
+
+static unsigned long long nextValue() {
+  return values[valueIndex++ % NUM_VALUES];
+}
+
+// The conversion of Print::printNumber() before the digit tables, with one %
+// and one / per digit, for comparison.
+__attribute__((noinline))
+static size_t legacyPrintNumber(Print& printer, unsigned long n, uint8_t base) {
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  return printer.write(str);
+}
+
+static double nextDouble() {
+  return doubleValues[valueIndex++ % NUM_VALUES];
+}
+
+static uint64_t nowNanos() {
+  struct timespec spec;
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  return (uint64_t) spec.tv_sec * 1000000000 + spec.tv_nsec;
+}
+
+// Keep the fastest of a few runs, to filter out the noise of other processes.
+const int NUM_RUNS = 5;
+
+static double nanosPerStatement(void (*statement)(Print&), Print& printer) {
+  uint64_t minElapsed = UINT64_MAX;
+  for (int run = 0; run < NUM_RUNS; run++) {
+    uint64_t start = nowNanos();
+    for (unsigned long i = 0; i < NUM_STATEMENTS; i++) {
+      statement(printer);
+    }
+    uint64_t elapsed = nowNanos() - start;
+    if (elapsed < minElapsed) minElapsed = elapsed;
+  }
+  return (double) minElapsed / NUM_STATEMENTS;
+}
+
+static void runBenchmark(const char* label, void (*statement)(Print&)) {
+  sink.writeCount = 0;
+  double nullNanos = nanosPerStatement(statement, sink);
+  double writes = (double) sink.writeCount / NUM_STATEMENTS / NUM_RUNS;
+
+  // Send the output of Serial to /dev/null during the measurement.
+  SERIAL_PORT_MONITOR.flush();
+  int savedStdout = dup(STDOUT_FILENO);
+  int devNull = open("/dev/null", O_WRONLY);
+  dup2(devNull, STDOUT_FILENO);
+  double serialNanos = nanosPerStatement(statement, SERIAL_PORT_MONITOR);
+  SERIAL_PORT_MONITOR.flush();
+  dup2(savedStdout, STDOUT_FILENO);
+  close(savedStdout);
+  close(devNull);
+
+  SERIAL_PORT_MONITOR.print(label);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(nullNanos, 1);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(serialNanos, 1);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(writes, 1);
+  SERIAL_PORT_MONITOR.println();
+}
+
+void setup() {
+  SERIAL_PORT_MONITOR.begin(115200);
+  SERIAL_PORT_MONITOR.setLineModeUnix();
+  initValues();
+
+  SERIAL_PORT_MONITOR.println(F("BENCHMARKS"));
+  SERIAL_PORT_MONITOR.println(F("statement null serial writes"));
+  runBenchmark("print(long)", [](Print& p) { p.print(longValue); });
+  runBenchmark("println(long)", [](Print& p) { p.println(longValue); });
+  runBenchmark("print(ulong,HEX)", [](Print& p) { p.print(hexValue, HEX); });
+  runBenchmark("println(double)", [](Print& p) { p.println(doubleValue); });
+  runBenchmark("print(const char*)", [](Print& p) { p.print("hello, world"); });
+  runBenchmark("println(const char*)", [](Print& p) {
+    p.println("hello, world");
+  });
+  runBenchmark("println(F())", [](Print& p) { p.println(F("hello, world")); });
+  runBenchmark("println(String)", [](Print& p) {
+    static String s("hello, world");
+    p.println(s);
+  });
+  runBenchmark("legacy(ulong)", [](Print& p) {
+    legacyPrintNumber(p, nextValue(), DEC);
+  });
+  runBenchmark("batch(ulong)", [](Print& p) {
+    p.print((unsigned long) nextValue());
+  });
+  runBenchmark("legacy(ulong,HEX)", [](Print& p) {
+    legacyPrintNumber(p, nextValue(), HEX);
+  });
+  runBenchmark("batch(ulong,HEX)", [](Print& p) {
+    p.print((unsigned long) nextValue(), HEX);
+  });
+  runBenchmark("batch(ulonglong)", [](Print& p) { p.print(nextValue()); });
+  runBenchmark("batch(double)", [](Print& p) { p.print(nextDouble()); });
+  runBenchmark("batch(double,6)", [](Print& p) { p.print(nextDouble(), 6); });
+  runBenchmark("printf(%ld %lX %s)", [](Print& p) {
+    p.printf("%ld %lX %s", longValue, hexValue, "hello, world");
+  });
+  runBenchmark("format({} {:X} {})", [](Print& p) {
+    p.format(EPOXY_FMT("{} {:X} {}"), longValue, hexValue, "hello, world");
+  });
+  SERIAL_PORT_MONITOR.println(F("END"));
+
+  exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,168 @@
+/*
+ * Measure the cost of writing and reading a Stream in nanoseconds per byte,
+ * for the in-memory MemoryStream and RingBufferStream, compared to writing to
+ * the StdioSerial `Serial`. Each iteration writes a 64-byte chunk, then reads
+ * it back, either one byte at a time using write(c) and read(), or in bulk
+ * using write(buf, n) and readBytes(). The `Serial` is only written, to
+ * /dev/null, so that the terminal does not distort the measurement. The
+ * `Stream::readBytes` row reads a RingBufferStream through the generic
+ * readBytes() of Stream, which copies the input using read(buf, n).
+ *
+ * On Linux or Mac, type:
+ *  * $ make
+ *  * $ ./StreamBenchmark.out
+ *
+ * Results in nanoseconds per byte on an Intel Xeon VM, Debian 12, g++ 12.2.
+ * The StdioSerial is only written, but also goes through its buffer, so most
+ * of its cost is the virtual call of write(c):
+ *
+ * ```
+ * BENCHMARKS
+ * stream byte bulk
+ * MemoryStream 10.0 0.3
+ * RingBufferStream 9.7 0.4
+ * Stream::readBytes 8.5 0.3
+ * StdioSerial 10.6 0.3
+ * END
+ * ```
+ *
+ * Before Stream::read(buf, n) was added, the generic readBytes() called
+ * timedRead() for each byte, and the bulk column of `Stream::readBytes` was
+ * 39.4 ns per byte.
+ */
+
+#include <Arduino.h>
+#include <MemoryStream.h>
+#include <RingBufferStream.h>
+#include <fcntl.h> // open()
+#include <time.h> // clock_gettime()
+#include <unistd.h> // dup(), dup2()
+
+#if ! defined(EPOXY_DUINO)
+  #error This benchmark is specific to EpoxyDuino
+#endif
+
+const size_t CHUNK_SIZE = 64;
+const unsigned long NUM_CHUNKS = 100000;
+const double NUM_BYTES = (double) CHUNK_SIZE * NUM_CHUNKS;
+
+// Prevent the compiler from optimizing away the reads.
+volatile int sink;
+
+uint8_t chunk[CHUNK_SIZE];
+
+static uint64_t nowNanos() {
+  struct timespec spec;
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  return (uint64_t) spec.tv_sec * 1000000000 + spec.tv_nsec;
+}
+
+static double nanosPerByteSingle(Stream& stream, bool readBack) {
+  int sum = 0;
+  uint64_t start = nowNanos();
+  for (unsigned long i = 0; i < NUM_CHUNKS; i++) {
+    for (size_t j = 0; j < CHUNK_SIZE; j++) {
+      stream.write(chunk[j]);
+    }
+    if (! readBack) continue;
+    for (size_t j = 0; j < CHUNK_SIZE; j++) {
+      sum += stream.read();
+    }
+  }
+  uint64_t elapsed = nowNanos() - start;
+  sink = sum;
+  return elapsed / NUM_BYTES;
+}
+
+static double nanosPerByteBulk(Stream& stream, bool readBack) {
+  uint8_t buf[CHUNK_SIZE];
+  int sum = 0;
+  uint64_t start = nowNanos();
+  for (unsigned long i = 0; i < NUM_CHUNKS; i++) {
+    stream.write(chunk, CHUNK_SIZE);
+    if (! readBack) continue;
+    stream.readBytes(buf, CHUNK_SIZE);
+    sum += buf[0];
+  }
+  uint64_t elapsed = nowNanos() - start;
+  sink = sum;
+  return elapsed / NUM_BYTES;
+}
+
+static void printResult(const char* label, double single, double bulk) {
+  SERIAL_PORT_MONITOR.print(label);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(single, 1);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(bulk, 1);
+  SERIAL_PORT_MONITOR.println();
+}
+
+static void runMemoryStream() {
+  MemoryStream stream;
+  double single = nanosPerByteSingle(stream, true);
+  double bulk = nanosPerByteBulk(stream, true);
+  printResult("MemoryStream", single, bulk);
+}
+
+static void runRingBufferStream() {
+  static RingBufferStream<4096> stream;
+  double single = nanosPerByteSingle(stream, true);
+  double bulk = nanosPerByteBulk(stream, true);
+  printResult("RingBufferStream", single, bulk);
+}
+
+/**
+ * A RingBufferStream read by the generic Stream::readBytes(), like a Stream
+ * which overrides only read().
+ */
+class GenericStream: public RingBufferStream<4096> {
+  public:
+    size_t readBytes(char* buffer, size_t length) override {
+      return Stream::readBytes(buffer, length);
+    }
+
+    using Stream::readBytes;
+};
+
+static void runGenericStream() {
+  static GenericStream stream;
+  double single = nanosPerByteSingle(stream, true);
+  double bulk = nanosPerByteBulk(stream, true);
+  printResult("Stream::readBytes", single, bulk);
+}
+
+static void runStdioSerial() {
+  // Send the output of Serial to /dev/null during the measurement.
+  SERIAL_PORT_MONITOR.flush();
+  int savedStdout = dup(STDOUT_FILENO);
+  int devNull = open("/dev/null", O_WRONLY);
+  dup2(devNull, STDOUT_FILENO);
+
+  double single = nanosPerByteSingle(SERIAL_PORT_MONITOR, false);
+  double bulk = nanosPerByteBulk(SERIAL_PORT_MONITOR, false);
+  SERIAL_PORT_MONITOR.flush();
+
+  dup2(savedStdout, STDOUT_FILENO);
+  close(savedStdout);
+  close(devNull);
+  printResult("StdioSerial", single, bulk);
+}
+
+void setup() {
+  SERIAL_PORT_MONITOR.begin(115200);
+  SERIAL_PORT_MONITOR.setLineModeUnix();
+  for (size_t i = 0; i < CHUNK_SIZE; i++) chunk[i] = 'a' + i % 26;
+
+  SERIAL_PORT_MONITOR.println(F("BENCHMARKS"));
+  SERIAL_PORT_MONITOR.println(F("stream byte bulk"));
+  runMemoryStream();
+  runRingBufferStream();
+  runGenericStream();
+  runStdioSerial();
+  SERIAL_PORT_MONITOR.println(F("END"));
+
+  exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,152 @@
+/*
+ * Measure the cost of building and copying String objects in nanoseconds per
+ * statement, or per character for the concatenation loops.
+ *
+ *  * "append(char,N)": append N single characters to an empty String
+ *  * "append(10,N)": append N characters 10 at a time to an empty String
+ *  * "assign(N)": assign a String of N characters to another String
+ *  * "move(N)": move-construct a String of N characters
+ *
+ * On Linux or Mac, type:
+ *  * $ make
+ *  * $ ./StringBenchmark.out
+ *
+ * Results on an Intel Xeon VM, Debian 12, g++ 12.2, -O2.
+ *
+ * Before the geometric growth of the buffer, and before the copies with
+ * memcpy() instead of strcpy(). Each append reallocated the buffer to the
+ * exact new length (99977 calls to realloc() for 100000 characters), which
+ * the realloc() of glibc mostly does in place:
+ *
+ * ```
+ * BENCHMARKS
+ * statement ns
+ * append(char,100) 11.2
+ * append(char,100000) 10.7
+ * append(10,100) 1.5
+ * append(10,100000) 1.3
+ * assign(10) 10.1
+ * assign(1000) 31.8
+ * move(10) 12.1
+ * move(1000) 1.7
+ * END
+ * ```
+ *
+ * After (21 calls to malloc() or realloc() for 100000 characters). The
+ * move(1000) statement is no longer inlined by the compiler, which costs a few
+ * nanoseconds:
+ *
+ * ```
+ * BENCHMARKS
+ * statement ns
+ * append(char,100) 4.2
+ * append(char,100000) 2.3
+ * append(10,100) 1.2
+ * append(10,100000) 0.5
+ * assign(10) 12.8
+ * assign(1000) 30.7
+ * move(10) 13.1
+ * move(1000) 4.5
+ * END
+ * ```
+ */
+
+#include <Arduino.h>
+#include <time.h> // clock_gettime()
+#include <utility> // std::move()
+
+#if ! defined(EPOXY_DUINO)
+  #error This benchmark is specific to EpoxyDuino
+#endif
+
+// Prevent the compiler from optimizing away the results.
+volatile unsigned int sink;
+
+static uint64_t nowNanos() {
+  struct timespec spec;
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  return (uint64_t) spec.tv_sec * 1000000000 + spec.tv_nsec;
+}
+
+static void printResult(const char* label, double nanos) {
+  SERIAL_PORT_MONITOR.print(label);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.println(nanos, 1);
+}
+
+/** Nanoseconds per character to append `n` chars one at a time. */
+static double appendChar(unsigned long n, unsigned long loops) {
+  uint64_t start = nowNanos();
+  for (unsigned long i = 0; i < loops; i++) {
+    String s;
+    for (unsigned long j = 0; j < n; j++) {
+      s += 'x';
+    }
+    sink = s.length();
+  }
+  return (nowNanos() - start) / ((double) n * loops);
+}
+
+/** Nanoseconds per character to append `n` chars 10 at a time. */
+static double appendChunk(unsigned long n, unsigned long loops) {
+  uint64_t start = nowNanos();
+  for (unsigned long i = 0; i < loops; i++) {
+    String s;
+    for (unsigned long j = 0; j < n; j += 10) {
+      s += "0123456789";
+    }
+    sink = s.length();
+  }
+  return (nowNanos() - start) / ((double) n * loops);
+}
+
+/** Nanoseconds per assignment of a String of `n` characters. */
+static double assign(unsigned long n, unsigned long loops) {
+  String source;
+  source.reserve(n);
+  for (unsigned long j = 0; j < n; j++) source += (char) ('a' + j % 26);
+
+  uint64_t start = nowNanos();
+  for (unsigned long i = 0; i < loops; i++) {
+    String s;
+    s = source;
+    sink = s.length();
+  }
+  return (nowNanos() - start) / (double) loops;
+}
+
+/** Nanoseconds per move construction of a String of `n` characters. */
+static double move(unsigned long n, unsigned long loops) {
+  String source;
+  source.reserve(n);
+  for (unsigned long j = 0; j < n; j++) source += (char) ('a' + j % 26);
+
+  uint64_t start = nowNanos();
+  for (unsigned long i = 0; i < loops; i++) {
+    String s(std::move(source));
+    sink = s.length();
+    source = std::move(s);
+  }
+  return (nowNanos() - start) / (double) loops;
+}
+
+void setup() {
+  SERIAL_PORT_MONITOR.begin(115200);
+  SERIAL_PORT_MONITOR.setLineModeUnix();
+
+  SERIAL_PORT_MONITOR.println(F("BENCHMARKS"));
+  SERIAL_PORT_MONITOR.println(F("statement ns"));
+  printResult("append(char,100)", appendChar(100, 100000));
+  printResult("append(char,100000)", appendChar(100000, 100));
+  printResult("append(10,100)", appendChunk(100, 100000));
+  printResult("append(10,100000)", appendChunk(100000, 100));
+  printResult("assign(10)", assign(10, 1000000));
+  printResult("assign(1000)", assign(1000, 1000000));
+  printResult("move(10)", move(10, 1000000));
+  printResult("move(1000)", move(1000, 1000000));
+  SERIAL_PORT_MONITOR.println(F("END"));
+
+  exit(0);
+}
+
+void loop() {}
@@ -70,7 +70,8 @@ public:
     size_t readBytes(char *buffer, size_t length) override {
         return read((uint8_t*)buffer, length);
     }
-    size_t read(uint8_t* buf, size_t size);
+    int read(uint8_t* buf, size_t size) override;
+    using Stream::read;
     bool seek(uint32_t pos, SeekMode mode);
     bool seek(uint32_t pos) {
         return seek(pos, SeekSet);
@@ -113,6 +114,7 @@ public:
     File openNextFile();
 
     String readString() override;
+    using Stream::readString;
 
     time_t getLastWrite();
     time_t getCreationTime();
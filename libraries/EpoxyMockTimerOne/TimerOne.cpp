@@ -3,8 +3,118 @@
  * Copyright (c) 2021 Brian T. Park
  */
 
+#include <Arduino.h> // micros()
+#include <EpoxyScheduler.h> // epoxyStartTimer()
+#include <WInterrupts.h> // epoxyQueueInterrupt()
 #include "TimerOne.h"
 
 void (*TimerOne::isrCallback)() = TimerOne::isrDefaultUnused;
 
 TimerOne Timer1;
+
+void TimerOne::setPeriod(unsigned long microseconds) {
+  // The hardware timer cannot count to 0.
+  periodMicros = (microseconds > 0) ? microseconds : 1;
+  start();
+}
+
+void TimerOne::start() {
+  startTimer(periodMicros);
+}
+
+void TimerOne::stop() {
+  if (timerId < 0) return;
+
+  long remaining = (long) (nextDeadline - micros());
+  remainingMicros = (remaining > 0) ? remaining : 0;
+  stopTimer();
+}
+
+void TimerOne::resume() {
+  if (timerId >= 0) return;
+  startTimer(remainingMicros);
+}
+
+void TimerOne::startTimer(unsigned long delayMicros) {
+  stopTimer();
+  nextDeadline = micros() + delayMicros;
+  timerId = epoxyStartTimer(delayMicros, periodMicros, handleTimer, this);
+}
+
+void TimerOne::stopTimer() {
+  if (timerId < 0) return;
+  epoxyStopTimer(timerId);
+  timerId = -1;
+}
+
+// Called by the scheduler at each period. Behaves like the overflow flag of
+// the timer, which is set until the interrupt handler runs.
+void TimerOne::handleTimer(void* arg) {
+  TimerOne* timer = static_cast<TimerOne*>(arg);
+  unsigned long deadline = timer->nextDeadline;
+  timer->nextDeadline += timer->periodMicros;
+  if (! timer->isrAttached) return;
+
+  if (timer->isrPending) {
+    timer->missedCount++;
+    return;
+  }
+  if (! epoxyQueueInterrupt(handleInterrupt, timer)) {
+    timer->missedCount++;
+    return;
+  }
+  timer->isrPending = true;
+  timer->pendingDeadline = deadline;
+}
+
+// Called through the interrupt queue of EpoxyDuino.
+void TimerOne::handleInterrupt(void* arg) {
+  TimerOne* timer = static_cast<TimerOne*>(arg);
+  timer->isrPending = false;
+  if (! timer->isrAttached) return;
+
+  unsigned long start = micros();
+  unsigned long latency = start - timer->pendingDeadline;
+  isrCallback();
+  unsigned long elapsed = micros() - start;
+
+  if (timer->tickCount == 0 || latency < timer->minLatencyMicros) {
+    timer->minLatencyMicros = latency;
+  }
+  if (latency > timer->maxLatencyMicros) timer->maxLatencyMicros = latency;
+  if (elapsed > timer->maxIsrMicros) timer->maxIsrMicros = elapsed;
+  timer->sumLatencyMicros += latency;
+  timer->sumIsrMicros += elapsed;
+  timer->tickCount++;
+}
+
+void TimerOne::resetStats() {
+  tickCount = 0;
+  missedCount = 0;
+  minLatencyMicros = 0;
+  maxLatencyMicros = 0;
+  sumLatencyMicros = 0;
+  maxIsrMicros = 0;
+  sumIsrMicros = 0;
+}
+
+void TimerOne::printStats(Print& printer) const {
+  unsigned long avgLatency = tickCount ? sumLatencyMicros / tickCount : 0;
+  unsigned long avgIsr = tickCount ? sumIsrMicros / tickCount : 0;
+  printer.print(F("period "));
+  printer.print(periodMicros);
+  printer.print(F(", ticks "));
+  printer.print(tickCount);
+  printer.print(F(", missed "));
+  printer.print(missedCount);
+  printer.print(F(", latency min/avg/max "));
+  printer.print(minLatencyMicros);
+  printer.print('/');
+  printer.print(avgLatency);
+  printer.print('/');
+  printer.print(maxLatencyMicros);
+  printer.print(F(", isr avg/max "));
+  printer.print(avgIsr);
+  printer.print('/');
+  printer.println(maxIsrMicros);
+}
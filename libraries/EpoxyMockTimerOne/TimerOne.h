@@ -6,7 +6,8 @@
 /**
  * @file Simple mock implementation of the TimerOne library
  * (https://github.com/PaulStoffregen/TimerOne) to allow code written against
- * that library to compile under EpoxyDuino.
+ * that library to compile under EpoxyDuino. The interrupt handler is called
+ * periodically by the EpoxyDuino event loop.
  */
 
 #ifndef EPOXY_MOCK_TIMER_ONE_H
@@ -14,11 +15,20 @@
 
 #include <stdint.h> // uint8_t
 
+class Print;
+
 /**
  * Mock implementation of the TimerOne class from the TimerOne library
  * (https://github.com/PaulStoffregen/TimerOne). Since TimerThree
  * (https://github.com/PaulStoffregen/TimerThree) has the exact same API, this
  * class can be substituted for TimerThree for mocking purposes.
+ *
+ * The timer is emulated using `epoxyStartTimer()`, so the interrupt handler is
+ * called from `yield()` or `delay()`, through the interrupt queue of
+ * EpoxyDuino. It is held while `noInterrupts()` is active. Like the overflow
+ * flag of the hardware timer, only one tick can be pending at a time, so the
+ * ticks which occur while the previous one is still pending are counted as
+ * missed.
  */
 class TimerOne {
   public:
@@ -26,20 +36,29 @@ class TimerOne {
     // Configuration
     //-------------------------------------------------------------------------
 
+    /** Set the period and start the timer. */
     void initialize(unsigned long microseconds=1000000) {
       setPeriod(microseconds);
     }
 
-    void setPeriod(unsigned long /*microseconds*/) {}
+    /** Set the period and start the timer, or restart it if it was running. */
+    void setPeriod(unsigned long microseconds);
 
     //-------------------------------------------------------------------------
     // Run Control
     //-------------------------------------------------------------------------
 
-    void start() {}
-    void stop() {}
-    void restart() {}
-    void resume() {}
+    /** Start the timer from the beginning of the period. */
+    void start();
+
+    /** Stop the timer. It can be continued using resume(). */
+    void stop();
+
+    /** Same as start(). */
+    void restart() { start(); }
+
+    /** Continue the timer stopped by stop() from where it was stopped. */
+    void resume();
 
     //-------------------------------------------------------------------------
     // PWM outputs
@@ -55,17 +74,76 @@ class TimerOne {
     // Interrupt Function
     //-------------------------------------------------------------------------
 
-    void attachInterrupt(void (*isr)()) { isrCallback = isr; }
+    void attachInterrupt(void (*isr)()) {
+      isrCallback = isr;
+      isrAttached = true;
+    }
 
     void attachInterrupt(void (*isr)(), unsigned long microseconds) {
       if (microseconds > 0) setPeriod(microseconds);
       attachInterrupt(isr);
     }
 
-    void detachInterrupt() {}
+    void detachInterrupt() { isrAttached = false; }
 
     static void (*isrCallback)(); // this is a static variable, not a function
     static void isrDefaultUnused() {}
+
+    //-------------------------------------------------------------------------
+    // Statistics, available only on EpoxyDuino.
+    //-------------------------------------------------------------------------
+
+    /** Number of times that the interrupt handler was called. */
+    unsigned long getTickCount() const { return tickCount; }
+
+    /** Number of ticks lost because the previous one was still pending. */
+    unsigned long getMissedCount() const { return missedCount; }
+
+    /** Minimum delay between the deadline of a tick and its handler call. */
+    unsigned long getMinLatencyMicros() const { return minLatencyMicros; }
+
+    /** Maximum delay between the deadline of a tick and its handler call. */
+    unsigned long getMaxLatencyMicros() const { return maxLatencyMicros; }
+
+    /** Maximum execution time of the interrupt handler. */
+    unsigned long getMaxIsrMicros() const { return maxIsrMicros; }
+
+    /** Reset the statistics. */
+    void resetStats();
+
+    /**
+     * Print the statistics on a single line, in microseconds. The latency is
+     * the jitter of the handler calls. A maximum handler time which is close
+     * to the period indicates that the handler does not fit in the period.
+     */
+    void printStats(Print& printer) const;
+
+  private:
+    static void handleTimer(void* arg);
+    static void handleInterrupt(void* arg);
+
+    void startTimer(unsigned long delayMicros);
+    void stopTimer();
+
+    unsigned long periodMicros = 1000000;
+    int timerId = -1;
+    bool isrAttached = false;
+    bool isrPending = false;
+
+    /** Deadline of the next tick, used when the timer is stopped or resumed. */
+    unsigned long nextDeadline = 0;
+    /** Deadline of the tick waiting in the interrupt queue. */
+    unsigned long pendingDeadline = 0;
+    /** Remaining time of the period when stop() was called. */
+    unsigned long remainingMicros = 0;
+
+    unsigned long tickCount = 0;
+    unsigned long missedCount = 0;
+    unsigned long minLatencyMicros = 0;
+    unsigned long maxLatencyMicros = 0;
+    unsigned long long sumLatencyMicros = 0;
+    unsigned long maxIsrMicros = 0;
+    unsigned long long sumIsrMicros = 0;
 };
 
 extern TimerOne Timer1;
@@ -0,0 +1,113 @@
+#line 2 "TimerOneTest.ino"
+
+#include <Arduino.h>
+#include <AUnit.h>
+#include <TimerOne.h>
+
+using aunit::TestRunner;
+
+//---------------------------------------------------------------------------
+
+static volatile int isrCount;
+static unsigned long isrWorkMicros;
+
+static void countIsr() {
+  isrCount++;
+  if (isrWorkMicros) delayMicroseconds(isrWorkMicros);
+}
+
+static void setUpTimer(unsigned long period) {
+  isrCount = 0;
+  isrWorkMicros = 0;
+  Timer1.initialize(period);
+  Timer1.attachInterrupt(countIsr);
+  Timer1.resetStats();
+}
+
+static void tearDownTimer() {
+  Timer1.detachInterrupt();
+  Timer1.stop();
+}
+
+test(periodicCallback) {
+  setUpTimer(100);
+
+  delay(1);
+  assertEqual(isrCount, 10);
+  assertEqual(Timer1.getTickCount(), 10UL);
+  assertEqual(Timer1.getMissedCount(), 0UL);
+  assertEqual(Timer1.getMaxLatencyMicros(), 0UL);
+
+  tearDownTimer();
+}
+
+test(stopAndResume) {
+  setUpTimer(10000);
+
+  delay(4);
+  Timer1.stop();
+  delay(20);
+  assertEqual(isrCount, 0);
+
+  // Continues with the remaining 6 millis of the period.
+  Timer1.resume();
+  delay(5);
+  assertEqual(isrCount, 0);
+  delay(1);
+  assertEqual(isrCount, 1);
+
+  tearDownTimer();
+}
+
+test(detachInterrupt) {
+  setUpTimer(100);
+
+  Timer1.detachInterrupt();
+  delay(1);
+  assertEqual(isrCount, 0);
+
+  tearDownTimer();
+}
+
+test(noInterruptsMissesTicks) {
+  setUpTimer(100);
+
+  // Only one tick can be pending while the interrupts are disabled.
+  noInterrupts();
+  delay(1);
+  assertEqual(isrCount, 0);
+  interrupts();
+  assertEqual(isrCount, 1);
+  assertEqual(Timer1.getMissedCount(), 9UL);
+  assertEqual(Timer1.getMaxLatencyMicros(), 900UL);
+
+  tearDownTimer();
+}
+
+test(isrLongerThanPeriod) {
+  setUpTimer(100);
+  isrWorkMicros = 150;
+
+  delay(1);
+  assertEqual(Timer1.getMaxIsrMicros(), 150UL);
+  assertMore(Timer1.getMissedCount(), 0UL);
+
+  tearDownTimer();
+}
+
+//---------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // needed for Leonardo/Micro
+
+  enableVirtualTime();
+}
+
+void loop() {
+  TestRunner::run();
+}
@@ -0,0 +1,119 @@
+#line 2 "EpoxySchedulerTest"
+
+#include <poll.h>
+#include <unistd.h>
+#include <Arduino.h>
+#include <EpoxyScheduler.h>
+#include <AUnit.h>
+
+using aunit::TestRunner;
+
+//---------------------------------------------------------------------------
+
+static int timerCount;
+static unsigned long timerMicros;
+
+static void countTimer(void* /*arg*/) {
+  timerCount++;
+  timerMicros = micros();
+}
+
+test(EpoxySchedulerTest, oneShotTimer) {
+  timerCount = 0;
+  unsigned long start = micros();
+  int id = epoxyStartTimer(5000, 0, countTimer, nullptr);
+  assertTrue(id >= 0);
+
+  delay(4);
+  assertEqual(timerCount, 0);
+  delay(2);
+  assertEqual(timerCount, 1);
+  assertEqual(timerMicros - start, 5000UL);
+
+  // One-shot timer does not fire again.
+  delay(10);
+  assertEqual(timerCount, 1);
+}
+
+test(EpoxySchedulerTest, periodicTimer) {
+  timerCount = 0;
+  unsigned long start = micros();
+  int id = epoxyStartTimer(100, 100, countTimer, nullptr);
+
+  // delay() under the virtual clock stops at each deadline.
+  delay(1);
+  assertEqual(timerCount, 10);
+  assertEqual(timerMicros - start, 1000UL);
+
+  epoxyStopTimer(id);
+  delay(1);
+  assertEqual(timerCount, 10);
+}
+
+test(EpoxySchedulerTest, nextTimerDeadline) {
+  unsigned long deadline;
+  assertFalse(epoxyNextTimerDeadline(&deadline));
+
+  unsigned long start = micros();
+  int id1 = epoxyStartTimer(300, 0, countTimer, nullptr);
+  int id2 = epoxyStartTimer(200, 0, countTimer, nullptr);
+  assertTrue(epoxyNextTimerDeadline(&deadline));
+  assertEqual(deadline - start, 200UL);
+
+  epoxyStopTimer(id1);
+  epoxyStopTimer(id2);
+}
+
+static int fdCount;
+static char fdChar;
+
+static void readPipe(int fd, short revents, void* /*arg*/) {
+  if (revents & POLLIN) {
+    fdCount++;
+    (void) ::read(fd, &fdChar, 1);
+  }
+}
+
+test(EpoxySchedulerTest, fdHandler) {
+  int fds[2];
+  assertEqual(pipe(fds), 0);
+  fdCount = 0;
+  assertTrue(epoxyAddFd(fds[0], POLLIN, readPipe, nullptr));
+
+  assertEqual(epoxyRunEvents(0), 0);
+  assertEqual(fdCount, 0);
+
+  assertEqual(::write(fds[1], "x", 1), 1);
+  assertEqual(epoxyRunEvents(0), 1);
+  assertEqual(fdCount, 1);
+  assertEqual(fdChar, 'x');
+
+  // Paused fd is not reported.
+  epoxySetFdEvents(fds[0], 0);
+  assertEqual(::write(fds[1], "y", 1), 1);
+  assertEqual(epoxyRunEvents(0), 0);
+  epoxySetFdEvents(fds[0], POLLIN);
+  assertEqual(epoxyRunEvents(0), 1);
+  assertEqual(fdChar, 'y');
+
+  epoxyRemoveFd(fds[0]);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+//---------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // needed for Leonardo/Micro
+
+  enableVirtualTime();
+}
+
+void loop() {
+  TestRunner::run();
+}
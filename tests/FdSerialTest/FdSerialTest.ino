@@ -0,0 +1,240 @@
+#line 2 "FdSerialTest"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <Arduino.h>
+#include <SerialTrace.h>
+#include <AUnit.h>
+
+using aunit::TestRunner;
+
+//---------------------------------------------------------------------------
+
+static char basePath[64];
+static char inPath[72];
+static char outPath[72];
+
+test(FdSerialTest, fifoReadWrite) {
+  snprintf(basePath, sizeof(basePath), "/tmp/FdSerialTest.%d", (int) getpid());
+  snprintf(inPath, sizeof(inPath), "%s.in", basePath);
+  snprintf(outPath, sizeof(outPath), "%s.out", basePath);
+
+  char spec[80];
+  snprintf(spec, sizeof(spec), "fifo:%s", basePath);
+  assertTrue(Serial1.open(spec));
+  assertEqual(Serial1.getPath(), (const char*) basePath);
+
+  int peerOut = open(inPath, O_WRONLY | O_NONBLOCK);
+  int peerIn = open(outPath, O_RDONLY | O_NONBLOCK);
+  assertTrue(peerOut >= 0);
+  assertTrue(peerIn >= 0);
+
+  // available() returns the real count of the input.
+  assertEqual(Serial1.available(), 0);
+  assertEqual((int) write(peerOut, "hello", 5), 5);
+  assertEqual(Serial1.available(), 5);
+  assertEqual(Serial1.read(), 'h');
+  char buf[8];
+  assertEqual(Serial1.readBytes(buf, 4), (size_t) 4);
+  assertEqual(memcmp(buf, "ello", 4), 0);
+
+  // The output is sent by yield().
+  Serial1.print("world");
+  assertEqual((int) read(peerIn, buf, sizeof(buf)), -1);
+  yield();
+  assertEqual((int) read(peerIn, buf, sizeof(buf)), 5);
+  assertEqual(memcmp(buf, "world", 5), 0);
+
+  close(peerOut);
+  close(peerIn);
+  Serial1.close();
+  assertEqual(Serial1.getPath(), "");
+  unlink(inPath);
+  unlink(outPath);
+}
+
+test(FdSerialTest, baudEmulationBlock) {
+  // Not connected, so the output is kept in the buffer then discarded.
+  Serial2.begin(9600);
+  Serial2.setBaudEmulation(EPOXY_BAUD_BLOCK);
+  assertEqual(Serial2.availableForWrite(), EPOXY_SERIAL_UART_BUFFER_SIZE);
+
+  // 9600 baud sends a byte every 1041.67 micros.
+  char buf[EPOXY_SERIAL_UART_BUFFER_SIZE + 10];
+  memset(buf, 'a', sizeof(buf));
+  unsigned long start = micros();
+  assertEqual(Serial2.write(buf, EPOXY_SERIAL_UART_BUFFER_SIZE), (size_t) 64);
+  assertEqual(Serial2.availableForWrite(), 0);
+  assertEqual(micros() - start, 0UL);
+
+  // The next 10 bytes wait for 10 byte times.
+  assertEqual(Serial2.write(buf, 10), (size_t) 10);
+  assertEqual(micros() - start, 10417UL);
+  assertEqual(Serial2.getTxBlockedMicros(), 10417UL);
+  assertEqual(Serial2.getTxDroppedCount(), 0UL);
+
+  // The buffer drains at the baud rate.
+  delay(100);
+  assertEqual(Serial2.availableForWrite(), EPOXY_SERIAL_UART_BUFFER_SIZE);
+  Serial2.setBaudEmulation(EPOXY_BAUD_OFF);
+}
+
+test(FdSerialTest, baudEmulationDrop) {
+  Serial3.begin(9600);
+  Serial3.setBaudEmulation(EPOXY_BAUD_DROP);
+
+  char buf[EPOXY_SERIAL_UART_BUFFER_SIZE + 10];
+  memset(buf, 'a', sizeof(buf));
+  unsigned long start = micros();
+  assertEqual(Serial3.write(buf, sizeof(buf)), (size_t) 64);
+  assertEqual(Serial3.write('a'), (size_t) 0);
+  assertEqual(Serial3.getTxDroppedCount(), 11UL);
+  assertEqual(micros() - start, 0UL);
+
+  delay(100);
+  assertEqual(Serial3.write('a'), (size_t) 1);
+  Serial3.setBaudEmulation(EPOXY_BAUD_OFF);
+}
+
+test(FdSerialTest, availableForWrite) {
+  Serial1.flush();
+  assertEqual(Serial1.availableForWrite(), EPOXY_SERIAL_TX_BUFFER_SIZE);
+}
+
+// Read from the non-blocking fd until 'size' bytes have arrived.
+static size_t readFully(int fd, char* buf, size_t size) {
+  size_t count = 0;
+  for (int i = 0; i < 10000 && count < size; i++) {
+    ssize_t n = read(fd, buf + count, size - count);
+    if (n > 0) {
+      count += n;
+    } else {
+      usleep(100);
+    }
+  }
+  return count;
+}
+
+test(FdSerialTest, writerThread) {
+  snprintf(basePath, sizeof(basePath), "/tmp/FdSerialTest.%d", (int) getpid());
+  snprintf(inPath, sizeof(inPath), "%s.in", basePath);
+  snprintf(outPath, sizeof(outPath), "%s.out", basePath);
+  char spec[80];
+  snprintf(spec, sizeof(spec), "fifo:%s", basePath);
+  assertTrue(Serial3.open(spec));
+  int peerIn = open(outPath, O_RDONLY | O_NONBLOCK);
+  assertTrue(peerIn >= 0);
+
+  // The writer sends the output without yield().
+  assertTrue(Serial3.startWriterThread(EPOXY_WRITER_BLOCK));
+  Serial3.print("hello");
+  Serial3.flush();
+  char buf[8];
+  assertEqual((int) read(peerIn, buf, sizeof(buf)), 5);
+  assertEqual(memcmp(buf, "hello", 5), 0);
+
+  // Nobody reads the fifo, so the pipe and the queue fill up, and the rest of
+  // the output is dropped without blocking.
+  assertTrue(Serial3.startWriterThread(EPOXY_WRITER_DROP_NEWEST));
+  const size_t size = 4 * EPOXY_SERIAL_WRITER_QUEUE_SIZE;
+  static char data[size];
+  static char received[size];
+  for (size_t i = 0; i < size; i++) data[i] = (char) (i % 251);
+  unsigned long droppedBefore = Serial3.getTxDroppedCount();
+  size_t accepted = Serial3.write(data, size);
+  assertLess(accepted, size);
+  unsigned long dropped = size - accepted;
+  assertEqual(Serial3.getTxDroppedCount() - droppedBefore, dropped);
+
+  // The accepted output arrives in order.
+  assertEqual(readFully(peerIn, received, accepted), accepted);
+  assertEqual(memcmp(received, data, accepted), 0);
+  Serial3.stopWriterThread();
+  assertEqual(Serial3.getTxDroppedCount() - droppedBefore, dropped);
+
+  close(peerIn);
+  Serial3.close();
+  unlink(inPath);
+  unlink(outPath);
+}
+
+test(FdSerialTest, traceAndReplay) {
+  char replayPath[80];
+  char tracePath[80];
+  snprintf(replayPath, sizeof(replayPath), "/tmp/FdSerialTest.%d.replay",
+      (int) getpid());
+  snprintf(tracePath, sizeof(tracePath), "/tmp/FdSerialTest.%d.trace",
+      (int) getpid());
+
+  // "hi" received at 1 ms, "xx" sent at 1 ms, "yo" received at 3 ms.
+  static const uint8_t records[] = {
+    'E', 'P', 'X', 'T', 1,
+    EPOXY_TRACE_RX, 0xE8, 0x07, 2, 'h', 'i',
+    EPOXY_TRACE_TX, 0, 2, 'x', 'x',
+    EPOXY_TRACE_RX, 0xD0, 0x0F, 2, 'y', 'o',
+  };
+  FILE* file = fopen(replayPath, "wb");
+  assertTrue(file != nullptr);
+  fwrite(records, 1, sizeof(records), file);
+  fclose(file);
+
+  // The replayed input arrives at its original timing, and is traced along
+  // with the output.
+  assertTrue(Serial2.startTrace(tracePath));
+  assertTrue(Serial2.startReplay(replayPath, true /*realtime*/));
+  assertEqual(Serial2.available(), 0);
+  delay(1);
+  assertEqual(Serial2.available(), 2);
+  assertEqual(Serial2.read(), 'h');
+  assertEqual(Serial2.read(), 'i');
+  Serial2.print("ok");
+  delay(1);
+  assertEqual(Serial2.available(), 0);
+  delay(1);
+  assertEqual(Serial2.available(), 2);
+  assertEqual(Serial2.read(), 'y');
+  assertEqual(Serial2.read(), 'o');
+  assertEqual(Serial2.read(), -1);
+  Serial2.stopTrace();
+
+  // Header, RX "hi", TX "ok", RX "yo".
+  file = fopen(tracePath, "rb");
+  assertTrue(file != nullptr);
+  fseek(file, 0, SEEK_END);
+  assertEqual(ftell(file), 22L);
+  fclose(file);
+
+  // The fast replay of the new trace returns all of its input immediately.
+  assertTrue(Serial2.startReplay(tracePath, false /*realtime*/));
+  assertEqual(Serial2.available(), 4);
+  char buf[4];
+  assertEqual(Serial2.readBytes(buf, 4), (size_t) 4);
+  assertEqual(memcmp(buf, "hiyo", 4), 0);
+  Serial2.stopReplay();
+
+  assertFalse(Serial2.startReplay("/nonexistent/trace", true));
+  unlink(replayPath);
+  unlink(tracePath);
+}
+
+test(FdSerialTest, unknownDevice) {
+  assertFalse(Serial2.open("serial:/dev/ttyUSB0"));
+}
+
+//---------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // needed for Leonardo/Micro
+
+  enableVirtualTime();
+}
+
+void loop() {
+  TestRunner::run();
+}
@@ -0,0 +1,137 @@
+#line 2 "InterruptTest"
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+using aunit::TestRunner;
+
+//---------------------------------------------------------------------------
+
+static const uint8_t PIN = 2;
+static volatile int isrCount;
+
+static void countIsr() {
+  isrCount++;
+}
+
+test(InterruptTest, digitalPinToInterrupt) {
+  assertEqual(digitalPinToInterrupt(2), 2);
+  assertEqual(digitalPinToInterrupt(32), NOT_AN_INTERRUPT);
+}
+
+test(InterruptTest, rising) {
+  digitalReadValue(PIN, LOW);
+  isrCount = 0;
+  attachInterrupt(digitalPinToInterrupt(PIN), countIsr, RISING);
+
+  // Handler is queued, then called at the next yield().
+  digitalReadValue(PIN, HIGH);
+  assertEqual(isrCount, 0);
+  yield();
+  assertEqual(isrCount, 1);
+
+  // Falling edge and unchanged value are ignored.
+  digitalReadValue(PIN, HIGH);
+  digitalReadValue(PIN, LOW);
+  yield();
+  assertEqual(isrCount, 1);
+
+  detachInterrupt(digitalPinToInterrupt(PIN));
+}
+
+test(InterruptTest, falling) {
+  digitalReadValue(PIN, HIGH);
+  isrCount = 0;
+  attachInterrupt(digitalPinToInterrupt(PIN), countIsr, FALLING);
+
+  digitalReadValue(PIN, LOW);
+  digitalReadValue(PIN, HIGH);
+  delay(1);
+  assertEqual(isrCount, 1);
+
+  detachInterrupt(digitalPinToInterrupt(PIN));
+  digitalReadValue(PIN, LOW);
+}
+
+test(InterruptTest, changeQueuesEveryEdge) {
+  digitalReadValue(PIN, LOW);
+  isrCount = 0;
+  attachInterrupt(digitalPinToInterrupt(PIN), countIsr, CHANGE);
+
+  for (int i = 0; i < 5; i++) {
+    digitalReadValue(PIN, HIGH);
+    digitalReadValue(PIN, LOW);
+  }
+  yield();
+  assertEqual(isrCount, 10);
+
+  detachInterrupt(digitalPinToInterrupt(PIN));
+}
+
+test(InterruptTest, noInterruptsMasksDispatch) {
+  digitalReadValue(PIN, LOW);
+  isrCount = 0;
+  attachInterrupt(digitalPinToInterrupt(PIN), countIsr, RISING);
+
+  noInterrupts();
+  digitalReadValue(PIN, HIGH);
+  yield();
+  delay(1);
+  assertEqual(isrCount, 0);
+
+  // Pending request is dispatched as soon as interrupts are enabled.
+  interrupts();
+  assertEqual(isrCount, 1);
+
+  detachInterrupt(digitalPinToInterrupt(PIN));
+  digitalReadValue(PIN, LOW);
+}
+
+test(InterruptTest, detachDropsPendingRequest) {
+  digitalReadValue(PIN, LOW);
+  isrCount = 0;
+  attachInterrupt(digitalPinToInterrupt(PIN), countIsr, RISING);
+
+  digitalReadValue(PIN, HIGH);
+  detachInterrupt(digitalPinToInterrupt(PIN));
+  yield();
+  assertEqual(isrCount, 0);
+
+  digitalReadValue(PIN, LOW);
+}
+
+#if defined(EPOXY_CORE_AVR)
+test(InterruptTest, lowLevel) {
+  digitalReadValue(PIN, HIGH);
+  isrCount = 0;
+  attachInterrupt(digitalPinToInterrupt(PIN), countIsr, LOW);
+
+  yield();
+  assertEqual(isrCount, 0);
+
+  // Level triggered handler is called on every dispatch while the pin is LOW.
+  digitalReadValue(PIN, LOW);
+  yield();
+  yield();
+  assertEqual(isrCount, 2);
+
+  detachInterrupt(digitalPinToInterrupt(PIN));
+}
+#endif
+
+//---------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // needed for Leonardo/Micro
+
+  enableVirtualTime();
+}
+
+void loop() {
+  TestRunner::run();
+}
@@ -0,0 +1,145 @@
+#line 2 "MemoryStreamTest"
+
+#include <Arduino.h>
+#include <MemoryStream.h>
+#include <RingBufferStream.h>
+#include <AUnit.h>
+
+using aunit::TestRunner;
+
+//---------------------------------------------------------------------------
+// MemoryStream
+//---------------------------------------------------------------------------
+
+test(MemoryStreamTest, printAndInspect) {
+  MemoryStream stream;
+  assertEqual(stream.c_str(), "");
+  assertEqual(stream.available(), 0);
+  assertEqual(stream.read(), -1);
+
+  stream.print(42);
+  stream.print(' ');
+  stream.print(F("abc"));
+  assertEqual(stream.c_str(), "42 abc");
+  assertEqual(stream.size(), (size_t) 6);
+  assertEqual(memcmp(stream.data(), "42 abc", 6), 0);
+
+  assertEqual(stream.peek(), '4');
+  assertEqual(stream.read(), '4');
+  assertEqual(stream.c_str(), "2 abc");
+
+  stream.clear();
+  assertEqual(stream.c_str(), "");
+}
+
+test(MemoryStreamTest, growAndReadBytes) {
+  MemoryStream stream;
+  char data[1000];
+  for (size_t i = 0; i < sizeof(data); i++) data[i] = (char) i;
+
+  // Interleave writes and reads, so that the buffer is compacted and grown.
+  for (int i = 0; i < 10; i++) {
+    assertEqual(stream.write(data, sizeof(data)), sizeof(data));
+    char buf[600];
+    assertEqual(stream.readBytes(buf, sizeof(buf)), sizeof(buf));
+  }
+  assertEqual(stream.available(), 4000);
+
+  // readBytes() does not wait for more data.
+  char buf[5000];
+  unsigned long start = millis();
+  assertEqual(stream.readBytes(buf, sizeof(buf)), (size_t) 4000);
+  assertLess(millis() - start, 10UL);
+  // 6000 bytes were read before, so the contents start at data[0].
+  assertEqual(memcmp(buf, data, sizeof(data)), 0);
+  assertEqual(stream.available(), 0);
+}
+
+// Runs in real time, with the default timeout.
+test(MemoryStreamTest, readDoesNotWait) {
+  MemoryStream stream;
+  stream.print("hello 12");
+  unsigned long start = millis();
+  assertEqual(stream.readString(), "hello 12");
+  assertEqual(stream.parseInt(), 0L);
+  assertLess(millis() - start, 10UL);
+
+  stream.print("hello 12");
+  start = millis();
+  assertEqual(stream.parseInt(), 12L);
+  assertEqual(stream.parseInt(), 0L);
+  assertLess(millis() - start, 10UL);
+}
+
+test(MemoryStreamTest, peekBuffer) {
+  MemoryStream stream;
+  stream.print("hello");
+  assertEqual(stream.peekAvailable(), (size_t) 5);
+  assertEqual(stream.peekBuffer()[0], 'h');
+  stream.peekConsume(2);
+  assertEqual(stream.c_str(), "llo");
+}
+
+//---------------------------------------------------------------------------
+// RingBufferStream
+//---------------------------------------------------------------------------
+
+test(RingBufferStreamTest, fullBufferDrops) {
+  RingBufferStream<8> stream;
+  assertEqual(stream.availableForWrite(), 8);
+  assertEqual(stream.write("0123456789", 10), (size_t) 8);
+  assertEqual(stream.availableForWrite(), 0);
+  assertEqual(stream.write('x'), (size_t) 0);
+  assertEqual(stream.available(), 8);
+
+  char buf[10];
+  assertEqual(stream.readBytes(buf, 3), (size_t) 3);
+  assertEqual(memcmp(buf, "012", 3), 0);
+  assertEqual(stream.availableForWrite(), 3);
+}
+
+test(RingBufferStreamTest, wrapAround) {
+  RingBufferStream<8> stream;
+  stream.write("012345", 6);
+  char buf[10];
+  stream.readBytes(buf, 4);
+
+  // "45" at the end, then "abcd" wrapped to the front.
+  assertEqual(stream.write("abcd", 4), (size_t) 4);
+  assertEqual(stream.available(), 6);
+  assertEqual(stream.peekAvailable(), (size_t) 4);
+  assertEqual(memcmp(stream.peekBuffer(), "45ab", 4), 0);
+  stream.peekConsume(4);
+  assertEqual(stream.peekAvailable(), (size_t) 2);
+  assertEqual(memcmp(stream.peekBuffer(), "cd", 2), 0);
+
+  stream.write("wxyz", 4);
+  assertEqual(stream.readBytes(buf, sizeof(buf)), (size_t) 6);
+  assertEqual(memcmp(buf, "cdwxyz", 6), 0);
+  assertEqual(stream.read(), -1);
+  assertEqual(stream.peek(), -1);
+}
+
+test(RingBufferStreamTest, readDoesNotWait) {
+  RingBufferStream<16> stream;
+  stream.print("hello 12");
+  unsigned long start = millis();
+  assertEqual(stream.readString(), "hello 12");
+  assertEqual(stream.parseInt(), 0L);
+  assertLess(millis() - start, 10UL);
+}
+
+//---------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // needed for Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
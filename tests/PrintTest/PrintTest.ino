@@ -0,0 +1,279 @@
+#line 2 "PrintTest"
+
+#include <float.h>
+#include <limits.h>
+#include <stdio.h>
+#include <wchar.h>
+#include <Arduino.h>
+#include <MemoryStream.h>
+#include <AUnit.h>
+
+using aunit::TestRunner;
+
+/** A MemoryStream which counts the calls to the bulk write(). */
+class CountingStream: public MemoryStream {
+  public:
+    size_t write(const uint8_t* buffer, size_t size) override {
+      writeCount++;
+      return MemoryStream::write(buffer, size);
+    }
+
+    using MemoryStream::write;
+
+    int writeCount = 0;
+};
+
+//---------------------------------------------------------------------------
+
+test(PrintTest, printNumber) {
+  MemoryStream out;
+  out.print(0);
+  out.print(' ');
+  out.print(-123);
+  out.print(' ');
+  out.print(LONG_MIN);
+  out.print(' ');
+  out.print(ULONG_MAX);
+  out.print(' ');
+  out.print(255, HEX);
+  out.print(' ');
+  out.print(5, BIN);
+  out.print(' ');
+  out.print(8, OCT);
+  out.print(' ');
+  out.print((unsigned char) 200);
+  out.print(65L, 0);
+
+  char expected[80];
+  snprintf(expected, sizeof(expected), "0 -123 %ld %lu FF 101 10 200A",
+      LONG_MIN, ULONG_MAX);
+  assertEqual(out.c_str(), (const char*) expected);
+}
+
+test(PrintTest, printLongLong) {
+  MemoryStream out;
+  out.print(LLONG_MIN);
+  out.print(' ');
+  out.print(ULLONG_MAX);
+  out.print(' ');
+  out.print(0x123456789ABCDEFULL, HEX);
+  out.print(' ');
+  out.print(-1LL, HEX);
+  out.print(' ');
+  out.println(1000000000000LL);
+  assertEqual(out.c_str(),
+      "-9223372036854775808 18446744073709551615 123456789ABCDEF "
+      "FFFFFFFFFFFFFFFF 1000000000000\r\n");
+
+  // Boundaries of the two-digit table.
+  out.clear();
+  const unsigned long values[] = {
+    1, 9, 10, 99, 100, 101, 999, 1000, 12345, 4294967295UL
+  };
+  for (unsigned long value : values) {
+    out.print(value);
+    out.print(' ');
+  }
+  out.print(35, 36);
+  assertEqual(out.c_str(), "1 9 10 99 100 101 999 1000 12345 4294967295 Z");
+}
+
+test(PrintTest, printFloat) {
+  MemoryStream out;
+  out.print(1.999, 2);
+  out.print(' ');
+  out.print(-3.14159, 3);
+  out.print(' ');
+  out.print(2.5, 0);
+  out.print(' ');
+  out.print(NAN);
+  assertEqual(out.c_str(), "2.00 -3.142 3 nan");
+
+  // The sign bit of -0.0 is not a part of the exponent.
+  out.clear();
+  out.print(-0.0);
+  out.print(' ');
+  out.print(-0.0, 0);
+  out.print(' ');
+  out.format(EPOXY_FMT("{}"), -0.0);
+  assertEqual(out.c_str(), "0.00 0 0.00");
+}
+
+test(PrintTest, printFloatFullRange) {
+  MemoryStream out;
+  out.print(4294967296.0, 2);
+  out.print(' ');
+  out.print(-1e20, 0);
+  out.print(' ');
+  out.print(3.4028235e38f, 0);
+  assertEqual(out.c_str(),
+      "4294967296.00 -100000000000000000000 "
+      "340282346638528859811704183484516925440");
+
+  // Rounded from the exact binary value, with ties away from zero.
+  out.clear();
+  out.print(1.005, 2); // 1.00499999999999989...
+  out.print(' ');
+  out.print(0.125, 2);
+  out.print(' ');
+  out.print(0.1, 20);
+  out.print(' ');
+  out.print(1e-5, 30);
+  out.print(' ');
+  out.print(-0.001, 2);
+  out.print(' ');
+  out.print(5e-324, 2);
+  out.print(' ');
+  out.print(-INFINITY);
+  assertEqual(out.c_str(),
+      "1.00 0.13 0.10000000000000000555 0.000010000000000000000818030539 "
+      "-0.00 0.00 inf");
+
+  // Same as printf() when there are no ties.
+  char expected[400];
+  out.clear();
+  out.print(DBL_MAX, 0);
+  snprintf(expected, sizeof(expected), "%.0f", DBL_MAX);
+  assertEqual(out.c_str(), (const char*) expected);
+
+  uint64_t x = 88172645463325252ULL;
+  for (int i = 0; i < 1000; i++) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    double value = (x >> 11) * 0x1p-53 * 1e6;
+    int digits = i % 18;
+    out.clear();
+    out.print(value, digits);
+    snprintf(expected, sizeof(expected), "%.*f", digits, value);
+    assertEqual(out.c_str(), (const char*) expected);
+  }
+}
+
+test(PrintTest, println) {
+  MemoryStream out;
+  out.println(42);
+  out.println("abc");
+  out.println(F("def"));
+  out.println('g');
+  out.println(String("hij"));
+  out.println(1.5);
+  out.println();
+  assertEqual(out.c_str(), "42\r\nabc\r\ndef\r\ng\r\nhij\r\n1.50\r\n\r\n");
+
+  out.clear();
+  out.setLineModeUnix();
+  out.println(-7);
+  assertEqual(out.c_str(), "-7\n");
+}
+
+test(PrintTest, printf) {
+  MemoryStream out;
+  size_t n = out.printf("%d|%-5s|%05.1f|%#x|%c|%%|%llu", -42, "ab", 3.14159,
+      255, 'z', ULLONG_MAX);
+  assertEqual(out.c_str(), "-42|ab   |003.1|0xff|z|%|18446744073709551615");
+  assertEqual(n, out.size());
+
+  // No limit on the length of the output.
+  out.clear();
+  char longString[1001];
+  memset(longString, 'x', 1000);
+  longString[1000] = '\0';
+  n = out.printf("[%s] %d", longString, 7);
+  assertEqual(n, (size_t) 1004);
+  assertEqual(out.size(), (size_t) 1004);
+  assertEqual(out.c_str() + 1000, "x] 7");
+
+  out.clear();
+  n = out.printf("%300d", 1);
+  assertEqual(n, (size_t) 300);
+  n = out.printf("%.400f", 1.0);
+  assertEqual(n, (size_t) 402);
+
+  // A floating point conversion wider than the buffer on the stack.
+  out.clear();
+  n = out.printf("%*f|", 100000, 1.0);
+  assertEqual(n, (size_t) 100001);
+  assertEqual(out.c_str() + 99990, "  1.000000|");
+}
+
+test(PrintTest, printfSameAsSnprintf) {
+  // The width and the precision beyond the exact digits are added without
+  // snprintf(), but give the same output.
+  static char expected[4000];
+  MemoryStream out;
+  const char* formats[] = {
+    "%012.3f|%-12.3e|%+12.3g|% 012.2a|%08f|%-8f",
+    "%.1100f|%.1200e|%#.1200g|%.1200g|%.20a|%.1200A",
+  };
+  for (const char* format : formats) {
+    out.clear();
+    out.printf(format, -3.14159, 2.5, 1e-10, 1.5, INFINITY, NAN);
+    snprintf(expected, sizeof(expected), format,
+        -3.14159, 2.5, 1e-10, 1.5, INFINITY, NAN);
+    assertEqual(out.c_str(), (const char*) expected);
+  }
+
+  out.clear();
+  out.printf("%.1100f|%1200.2f|%.30Lf|%Le", 5e-324, DBL_MAX, 0.1L, LDBL_MAX);
+  snprintf(expected, sizeof(expected), "%.1100f|%1200.2f|%.30Lf|%Le",
+      5e-324, DBL_MAX, 0.1L, LDBL_MAX);
+  assertEqual(out.c_str(), (const char*) expected);
+
+  out.clear();
+  out.printf("%5ls|%-5ls|%.2ls|%3lc|%-3lc|", L"ab", L"ab", L"abc",
+      (wint_t) L'x', (wint_t) L'y');
+  assertEqual(out.c_str(), "   ab|ab   |ab|  x|y  |");
+}
+
+test(PrintTest, format) {
+  MemoryStream out;
+  String s("str");
+  size_t n = out.format(
+      EPOXY_FMT("{} {:X} {:b} {:.3} {} {} {} {} {{{}}}"),
+      -42, 255u, 5, 3.14159, 'c', "lit", s, F("flash"), ULLONG_MAX);
+  assertEqual(out.c_str(),
+      "-42 FF 101 3.142 c lit str flash {18446744073709551615}");
+  assertEqual(n, out.size());
+
+  out.clear();
+  out.format(EPOXY_FMT("no placeholders"));
+  out.format(EPOXY_FMT("{}"), 2.5);
+  assertEqual(out.c_str(), "no placeholders2.50");
+}
+
+test(PrintTest, oneWritePerStatement) {
+  CountingStream out;
+  out.println(-1234567L);
+  assertEqual(out.writeCount, 1);
+  out.println(3.14159, 4);
+  assertEqual(out.writeCount, 2);
+  out.println(F("hello, world"));
+  assertEqual(out.writeCount, 3);
+  out.print(0xDEADBEEF, HEX);
+  assertEqual(out.writeCount, 4);
+  assertEqual(out.c_str(), "-1234567\r\n3.1416\r\nhello, world\r\nDEADBEEF");
+
+  // Strings longer than the internal buffer are written directly.
+  out.clear();
+  char longString[201];
+  memset(longString, 'x', 200);
+  longString[200] = '\0';
+  out.println(longString);
+  assertEqual(out.size(), (size_t) 202);
+}
+
+//---------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // needed for Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
@@ -0,0 +1,241 @@
+#line 2 "StreamTest"
+
+#include <Arduino.h>
+#include <Client.h>
+#include <MemoryStream.h>
+#include <AUnit.h>
+
+using aunit::TestRunner;
+
+//---------------------------------------------------------------------------
+
+/** A MemoryStream whose input arrives after a few waits. */
+class WaitingStream: public MemoryStream {
+  public:
+    int waitCount = 0;
+    unsigned long lastMaxMillis = 0;
+
+  protected:
+    void waitForInput(unsigned long maxMillis) override {
+      waitCount++;
+      lastMaxMillis = maxMillis;
+      if (waitCount == 3) print("42 ");
+      MemoryStream::waitForInput(maxMillis);
+    }
+};
+
+/** A MemoryStream which gives access to findMulti(). */
+class FindStream: public MemoryStream {
+  public:
+    using Stream::MultiTarget;
+    using Stream::findMulti;
+};
+
+/** A FindStream without the peek buffer API, read one byte at a time. */
+class BytewiseStream: public FindStream {
+  public:
+    bool hasPeekBufferAPI() const override { return false; }
+};
+
+static int findMulti(FindStream& stream, const char* a, const char* b) {
+  FindStream::MultiTarget targets[] = {
+    {a, strlen(a), 0},
+    {b, strlen(b), 0},
+  };
+  return stream.findMulti(targets, 2);
+}
+
+test(StreamTest, find) {
+  // The Arduino API takes a `char*`, not a `const char*`.
+  char overlapped[] = "1112";
+  char highBytes[] = "\xFE\xFF";
+  char def[] = "def";
+  char semicolon[] = ";";
+  char x[] = "x";
+
+  FindStream bulk;
+  BytewiseStream bytewise;
+  FindStream* streams[] = {&bulk, &bytewise};
+  for (FindStream* stream : streams) {
+    stream->setTimeout(0);
+
+    // The target must be found after a partial match of itself.
+    stream->print("11112rest");
+    assertTrue(stream->find(overlapped));
+    assertEqual(stream->c_str(), "rest");
+    stream->clear();
+
+    // The first target to end wins, and the lowest index if both end at the
+    // same byte.
+    stream->print("xabcdz");
+    assertEqual(findMulti(*stream, "abcd", "bc"), 1);
+    assertEqual(stream->c_str(), "dz");
+    stream->clear();
+    stream->print("xabcz");
+    assertEqual(findMulti(*stream, "bc", "abc"), 0);
+    assertEqual(findMulti(*stream, "abc", "z"), 1);
+    stream->clear();
+
+    // Bytes above 0x7F.
+    stream->print("\x01\xFF\xFE\xFFok");
+    assertTrue(stream->find(highBytes));
+    assertEqual(stream->c_str(), "ok");
+    stream->clear();
+
+    // Not found, or found after the terminator.
+    stream->print("abc;def");
+    assertFalse(stream->findUntil(def, semicolon));
+    assertEqual(stream->c_str(), "def");
+    assertFalse(stream->find(x));
+    assertEqual(stream->available(), 0);
+  }
+}
+
+/** A Stream which implements only read(), over the string `data`. */
+class ByteStream: public Stream {
+  public:
+    const char* data = "";
+
+    size_t write(uint8_t) override { return 0; }
+    int available() override { return strlen(data); }
+    int read() override { return (*data == '\0') ? -1 : *data++; }
+    int peek() override { return (*data == '\0') ? -1 : *data; }
+};
+
+test(StreamTest, readBuffer) {
+  ByteStream byteStream;
+  byteStream.data = "abcdef";
+  // The read() of ByteStream hides read(buf, size) of Stream.
+  Stream& stream = byteStream;
+  uint8_t buf[10];
+  assertEqual(stream.read(buf, 4), 4);
+  assertEqual(memcmp(buf, "abcd", 4), 0);
+  assertEqual(stream.read(buf, sizeof(buf)), 2);
+  assertEqual(memcmp(buf, "ef", 2), 0);
+  assertEqual(stream.read(buf, sizeof(buf)), 0);
+
+  MemoryStream memory;
+  memory.print("xyz");
+  assertEqual(memory.read((char*) buf, sizeof(buf)), 3);
+  assertEqual(memcmp(buf, "xyz", 3), 0);
+}
+
+#if defined(EPOXY_CORE_ESP8266)
+
+/** A Client which implements only the single byte read(). */
+class ByteClient: public Client {
+  public:
+    const char* data = "";
+
+    int connect(IPAddress, uint16_t) override { return 1; }
+    int connect(const char*, uint16_t) override { return 1; }
+    size_t write(uint8_t) override { return 0; }
+    size_t write(const uint8_t*, size_t) override { return 0; }
+    int available() override { return strlen(data); }
+    int read() override { return (*data == '\0') ? -1 : *data++; }
+    int peek() override { return (*data == '\0') ? -1 : *data; }
+    void flush() override {}
+    void stop() override {}
+    uint8_t connected() override { return 1; }
+    operator bool() override { return true; }
+};
+
+test(StreamTest, clientReadBuffer) {
+  // The bulk read is inherited from Stream, not required from the subclass.
+  ByteClient byteClient;
+  byteClient.data = "abc";
+  Client& client = byteClient;
+  uint8_t buf[10];
+  assertEqual(client.read(buf, sizeof(buf)), 3);
+  assertEqual(memcmp(buf, "abc", 3), 0);
+}
+
+#endif
+
+test(StreamTest, readBytesUntil) {
+  FindStream bulk;
+  BytewiseStream bytewise;
+  FindStream* streams[] = {&bulk, &bytewise};
+  for (FindStream* stream : streams) {
+    stream->setTimeout(0);
+    char buf[10];
+    stream->print("ab,cdefghijklm,");
+    assertEqual(stream->readBytesUntil(',', buf, sizeof(buf)), (size_t) 2);
+    assertEqual(memcmp(buf, "ab", 2), 0);
+
+    // Stops at the length without consuming the rest.
+    assertEqual(stream->readBytesUntil(',', buf, 4), (size_t) 4);
+    assertEqual(memcmp(buf, "cdef", 4), 0);
+    assertEqual(stream->readBytesUntil(',', buf, sizeof(buf)), (size_t) 7);
+    assertEqual(memcmp(buf, "ghijklm", 7), 0);
+    assertEqual(stream->available(), 0);
+  }
+}
+
+test(StreamTest, readString) {
+  FindStream bulk;
+  BytewiseStream bytewise;
+  FindStream* streams[] = {&bulk, &bytewise};
+  for (FindStream* stream : streams) {
+    stream->setTimeout(0);
+    stream->print("first\nsecond\n\xFF");
+    stream->write('\0');
+    stream->print("third\xFF");
+    assertEqual(stream->readStringUntil('\n'), "first");
+
+    // Reuse the same String, which keeps its buffer.
+    String line;
+    assertEqual(stream->readStringUntil('\n', line), (size_t) 6);
+    assertEqual(line, "second");
+    assertEqual(stream->readStringUntil('\xFF', line), (size_t) 0);
+    assertEqual(stream->readStringUntil('\xFF', line), (size_t) 6);
+    assertEqual(memcmp(line.c_str(), "\0third", 6), 0);
+    assertEqual(stream->readString(line), (size_t) 0);
+    assertEqual(line, "");
+
+    // Longer than a few chunks.
+    for (int i = 0; i < 1000; i++) stream->print("0123456789");
+    assertEqual(stream->readString().length(), 10000u);
+  }
+}
+
+test(StreamTest, readBytesWaits) {
+  WaitingStream stream;
+  stream.setTimeout(100);
+  stream.print("ab");
+  char buf[10];
+  // "ab", then "42 " after 3 waits, then the timeout.
+  assertEqual(stream.Stream::readBytes(buf, sizeof(buf)), (size_t) 5);
+  assertEqual(memcmp(buf, "ab42 ", 5), 0);
+}
+
+test(StreamTest, waitForInput) {
+  WaitingStream stream;
+  stream.setTimeout(100);
+  assertEqual(stream.parseInt(), 42L);
+  assertEqual(stream.waitCount, 3);
+  assertLessOrEqual(stream.lastMaxMillis, 100UL);
+
+  // Nothing arrives, so the waits continue until the timeout.
+  unsigned long start = millis();
+  assertEqual(stream.parseInt(), 0L);
+  assertMoreOrEqual(millis() - start, 100UL);
+  assertLessOrEqual(stream.lastMaxMillis, 100UL);
+}
+
+//---------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // needed for Leonardo/Micro
+
+  enableVirtualTime();
+}
+
+void loop() {
+  TestRunner::run();
+}
@@ -0,0 +1,169 @@
+#line 2 "StringTest"
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+using aunit::TestRunner;
+
+//---------------------------------------------------------------------------
+
+/** Exposes the buffer of the String, to check where it is stored. */
+class InspectString: public String {
+  public:
+    using String::String;
+
+    bool isInline() const { return buffer == inlineBuffer; }
+
+    unsigned int getCapacity() const { return capacity; }
+};
+
+static const unsigned int kInline = EPOXY_STRING_INLINE_CAPACITY;
+
+test(StringTest, inlineBuffer) {
+  InspectString empty;
+  assertTrue(empty.isInline());
+  assertTrue((bool) empty);
+  assertEqual(empty.c_str(), "");
+
+  InspectString c('x');
+  assertTrue(c.isInline());
+  assertEqual(c.c_str(), "x");
+
+  InspectString number(-1234567890L);
+  assertTrue(number.isInline());
+  assertEqual(number.c_str(), "-1234567890");
+
+  // Grows out of the inline buffer at its capacity.
+  InspectString s;
+  for (unsigned int i = 0; i < kInline; i++) s += 'a';
+  assertTrue(s.isInline());
+  s += 'b';
+  assertFalse(s.isInline());
+  assertEqual(s.length(), kInline + 1);
+  assertEqual(s.charAt(kInline - 1), 'a');
+  assertEqual(s.charAt(kInline), 'b');
+}
+
+test(StringTest, copyAndMove) {
+  String shortString("short");
+  String longString("a string which is too long for the inline buffer");
+
+  // Copies of short strings have their own inline buffer.
+  String copy(shortString);
+  copy += "er";
+  assertEqual(copy, "shorter");
+  assertEqual(shortString, "short");
+
+  InspectString longCopy(longString);
+  assertEqual(longCopy, longString);
+  assertTrue(longCopy.c_str() != longString.c_str());
+
+  // Moving a short string copies its inline buffer.
+  String moved(std::move(copy));
+  assertEqual(moved, "shorter");
+  copy = "reused";
+  assertEqual(copy, "reused");
+
+  // Moving a long string into an inline string takes over its buffer.
+  const char* heap = longCopy.c_str();
+  moved = std::move(longCopy);
+  assertTrue(moved.c_str() == heap);
+  assertEqual(moved, longString);
+  // The moved-from string is valid and empty, in its inline buffer.
+  assertTrue((bool) longCopy);
+  assertEqual(longCopy, "");
+  assertTrue(longCopy.isInline());
+  longCopy += "reused";
+  assertEqual(longCopy, "reused");
+
+  // Assigning a short string to a long one keeps the heap buffer.
+  moved = shortString;
+  assertEqual(moved, "short");
+  assertTrue(moved.c_str() == heap);
+  moved = std::move(shortString);
+  assertEqual(moved, "short");
+  assertEqual(shortString, "");
+}
+
+test(StringTest, invalidate) {
+  String s("x");
+  s = (const char*) nullptr;
+  assertFalse((bool) s);
+  assertTrue(s.reserve(0));
+  assertTrue((bool) s);
+  assertEqual(s, "");
+}
+
+test(StringTest, concatSelf) {
+  String s("abc");
+  s += s;
+  assertEqual(s, "abcabc");
+  while (s.length() <= kInline) s += s;
+  assertEqual(s.length(), 24u);
+  assertTrue(s.startsWith("abcabcabc"));
+  assertTrue(s.endsWith("abcabc"));
+}
+
+test(StringTest, geometricGrowth) {
+  InspectString s;
+  int reallocs = 0;
+  unsigned int capacity = s.getCapacity();
+  for (int i = 0; i < 10000; i++) {
+    s += 'x';
+    if (s.getCapacity() != capacity) {
+      reallocs++;
+      capacity = s.getCapacity();
+    }
+  }
+  assertEqual(s.length(), 10000u);
+  assertLessOrEqual(reallocs, 20);
+
+  // reserve() is exact, then shrinkToFit() releases the unused capacity.
+  assertTrue(s.reserve(20000));
+  assertEqual(s.getCapacity(), 20000u);
+  assertTrue(s.shrinkToFit());
+  assertEqual(s.getCapacity(), 10000u);
+  assertEqual(s.charAt(9999), 'x');
+
+  // A short string moves back into the inline buffer.
+  s.remove(3);
+  assertTrue(s.shrinkToFit());
+  assertTrue(s.isInline());
+  assertEqual(s.c_str(), "xxx");
+}
+
+test(StringTest, embeddedNul) {
+  String s("ab");
+  s.concat("\0cd", 3);
+  assertEqual(s.length(), 5u);
+
+  // Copies and moves keep the characters after the NUL.
+  String copy;
+  copy = s;
+  assertEqual(copy.length(), 5u);
+  assertEqual(memcmp(copy.c_str(), "ab\0cd", 6), 0);
+  String longer(s);
+  for (int i = 0; i < 10; i++) longer += s;
+  String moved(std::move(longer));
+  assertEqual(moved.length(), 55u);
+  assertEqual(memcmp(moved.c_str() + 50, "ab\0cd", 6), 0);
+
+  // Assigning a part of itself.
+  moved = moved.c_str() + 53;
+  assertEqual(moved, "cd");
+}
+
+//---------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // needed for Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
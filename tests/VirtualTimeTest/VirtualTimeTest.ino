@@ -0,0 +1,61 @@
+#line 2 "VirtualTimeTest"
+
+#include <Arduino.h>
+#include <AUnit.h>
+
+using aunit::TestRunner;
+
+//---------------------------------------------------------------------------
+
+test(VirtualTimeTest, enabled) {
+  assertTrue(isVirtualTimeEnabled());
+}
+
+test(VirtualTimeTest, delay_advances_clock_without_sleeping) {
+  unsigned long startMillis = millis();
+  unsigned long startMicros = micros();
+
+  // 10 minutes of virtual time should return immediately.
+  delay(600000UL);
+  assertEqual(millis() - startMillis, 600000UL);
+  assertEqual(micros() - startMicros, 600000000UL);
+
+  delayMicroseconds(10);
+  assertEqual(micros() - startMicros, 600000010UL);
+}
+
+test(VirtualTimeTest, yield_advances_clock_by_quantum) {
+  unsigned long start = micros();
+  yield();
+  assertEqual(micros() - start, 1000UL);
+
+  setVirtualTimeQuantum(25);
+  start = micros();
+  yield();
+  yield();
+  assertEqual(micros() - start, 50UL);
+  setVirtualTimeQuantum(1000);
+}
+
+test(VirtualTimeTest, advanceVirtualTime) {
+  unsigned long start = millis();
+  advanceVirtualTime(3000000UL);
+  assertEqual(millis() - start, 3000UL);
+}
+
+//---------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // needed for Leonardo/Micro
+
+  enableVirtualTime();
+}
+
+void loop() {
+  TestRunner::run();
+}
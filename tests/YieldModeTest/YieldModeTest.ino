@@ -0,0 +1,117 @@
+#line 2 "YieldModeTest"
+
+#include <poll.h>
+#include <unistd.h>
+#include <Arduino.h>
+#include <EpoxyScheduler.h>
+#include <AUnit.h>
+
+using aunit::TestRunner;
+
+// These tests use the real clock, since yield() does not wait with the
+// virtual clock. Only the lower bounds of the waits are checked.
+
+//---------------------------------------------------------------------------
+
+static int fdCount;
+
+static void countFd(int /*fd*/, short /*revents*/, void* /*arg*/) {
+  fdCount++;
+}
+
+static void drainPipe(int fd, short revents, void* /*arg*/) {
+  char c;
+  if (revents & POLLIN) (void) ::read(fd, &c, 1);
+  fdCount++;
+}
+
+static int timerCount;
+
+static void countTimer(void* /*arg*/) {
+  timerCount++;
+}
+
+/** Microseconds taken by one call to yield(). */
+static unsigned long timeYield() {
+  // Pending output of the TestRunner would wake up yield().
+  SERIAL_PORT_MONITOR.flush();
+  unsigned long start = micros();
+  yield();
+  return micros() - start;
+}
+
+test(YieldModeTest, sleep) {
+  setYieldMode(EPOXY_YIELD_SLEEP);
+  assertEqual(getYieldMode(), EPOXY_YIELD_SLEEP);
+
+  // Let the Serial port handle its pending events, e.g. the end of STDIN.
+  for (int i = 0; i < 3; i++) yield();
+
+  // Nothing happens, so yield() waits for the whole millisecond.
+  assertMoreOrEqual(timeYield(), 900UL);
+}
+
+test(YieldModeTest, spin) {
+  // A pipe which stays readable counts the polls.
+  int fds[2];
+  assertEqual(pipe(fds), 0);
+  assertEqual(::write(fds[1], "x", 1), 1);
+  assertTrue(epoxyAddFd(fds[0], POLLIN, countFd, nullptr));
+
+  setYieldMode(EPOXY_YIELD_SPIN);
+  fdCount = 0;
+  for (int i = 0; i < 10 * EPOXY_YIELD_SPIN_POLL_INTERVAL; i++) yield();
+  assertEqual(fdCount, 10);
+
+  // The timers still run on every yield().
+  timerCount = 0;
+  int id = epoxyStartTimer(0, 0, countTimer, nullptr);
+  yield();
+  assertEqual(timerCount, 1);
+  epoxyStopTimer(id);
+
+  setYieldMode(EPOXY_YIELD_SLEEP);
+  epoxyRemoveFd(fds[0]);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+test(YieldModeTest, adaptive) {
+  int fds[2];
+  assertEqual(pipe(fds), 0);
+  assertTrue(epoxyAddFd(fds[0], POLLIN, drainPipe, nullptr));
+  setYieldMode(EPOXY_YIELD_ADAPTIVE);
+
+  // The wait doubles from 1 microsecond while idle, up to 1 millisecond.
+  for (int i = 0; i < 12; i++) yield();
+  assertMoreOrEqual(timeYield(), 900UL);
+
+  // An event resets the wait, then it starts doubling again.
+  fdCount = 0;
+  assertEqual(::write(fds[1], "x", 1), 1);
+  yield();
+  assertEqual(fdCount, 1);
+  unsigned long total = 0;
+  for (int i = 0; i < 5; i++) total += timeYield();
+  assertLess(total, 900UL);
+
+  setYieldMode(EPOXY_YIELD_SLEEP);
+  epoxyRemoveFd(fds[0]);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+//---------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // needed for Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}